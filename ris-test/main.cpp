@@ -1,59 +1,184 @@
+#include <chrono>
 #include <cstdint>
+#include <cstring>
 #include <iostream>
 #include <memory>
 
+#include "minimizer.h"
 #include "testgen.h"
-#include "testbench.h"
+#include "runner.h"
 
 struct Config
 {
 	char const *rerun_test_file;
+	char const *minimize_test_file;
 	uint32_t num_tests;
+	uint32_t num_jobs;
+	WritePacing write_pacing;
+	uint32_t bus_latency;
+	RowDrain row_drain;
+	StatusWait status_wait;
+	uint32_t capture_cycles;
+	bool coverage_guided;
 };
 
+[[noreturn]] void print_usage() {
+	std::cout << "usage: testbench [--rerun <test-file>] [--minimize <test-file>] [--run <num-tests>]\n"
+	             "                 [--jobs <num-jobs>]\n"
+	             "                 [--pacing fixed|adaptive] [--bus-latency <cycles>]\n"
+	             "                 [--drain registers|delta] [--wait poll|interrupt]\n"
+	             "                 [--capture <cycles>] [--generator random|coverage]\n";
+	exit(-1);
+}
+
 Config parse_arguments(int argc, char **argv) {
-	if (argc == 3) {
-		if (strcmp(argv[1], "--rerun") == 0) {
-			return { argv[2], 1 };
-		} else if (strcmp(argv[1], "--run") == 0) {
-			int num_tests = std::atoi(argv[2]);
-			if (num_tests > 0) {
-				return { nullptr, (uint32_t)num_tests };
+	Config config = { nullptr, nullptr, 0, 1, WRITE_PACING_FIXED, FIXED_WRITE_PACING_CYCLES, ROW_DRAIN_REGISTERS,
+	                  STATUS_WAIT_POLL, 0, false };
+
+	for (int i = 1; i < argc; i += 2) {
+		if (i + 1 >= argc) {
+			print_usage();
+		}
+		if (strcmp(argv[i], "--rerun") == 0) {
+			config.rerun_test_file = argv[i + 1];
+			config.num_tests       = 1;
+		} else if (strcmp(argv[i], "--minimize") == 0) {
+			config.minimize_test_file = argv[i + 1];
+			config.num_tests          = 1;
+		} else if (strcmp(argv[i], "--run") == 0) {
+			int num_tests = std::atoi(argv[i + 1]);
+			if (num_tests <= 0) {
+				print_usage();
+			}
+			config.num_tests = (uint32_t)num_tests;
+		} else if (strcmp(argv[i], "--jobs") == 0) {
+			int num_jobs = std::atoi(argv[i + 1]);
+			if (num_jobs <= 0) {
+				print_usage();
+			}
+			config.num_jobs = (uint32_t)num_jobs;
+		} else if (strcmp(argv[i], "--pacing") == 0) {
+			if (strcmp(argv[i + 1], "fixed") == 0) {
+				config.write_pacing = WRITE_PACING_FIXED;
+			} else if (strcmp(argv[i + 1], "adaptive") == 0) {
+				config.write_pacing = WRITE_PACING_ADAPTIVE;
+			} else {
+				print_usage();
+			}
+		} else if (strcmp(argv[i], "--bus-latency") == 0) {
+			int bus_latency = std::atoi(argv[i + 1]);
+			if (bus_latency <= 0) {
+				print_usage();
+			}
+			config.bus_latency = (uint32_t)bus_latency;
+		} else if (strcmp(argv[i], "--drain") == 0) {
+			if (strcmp(argv[i + 1], "registers") == 0) {
+				config.row_drain = ROW_DRAIN_REGISTERS;
+			} else if (strcmp(argv[i + 1], "delta") == 0) {
+				config.row_drain = ROW_DRAIN_DELTA;
+			} else {
+				print_usage();
 			}
+		} else if (strcmp(argv[i], "--wait") == 0) {
+			if (strcmp(argv[i + 1], "poll") == 0) {
+				config.status_wait = STATUS_WAIT_POLL;
+			} else if (strcmp(argv[i + 1], "interrupt") == 0) {
+				config.status_wait = STATUS_WAIT_INTERRUPT;
+			} else {
+				print_usage();
+			}
+		} else if (strcmp(argv[i], "--capture") == 0) {
+			int capture_cycles = std::atoi(argv[i + 1]);
+			if (capture_cycles <= 0) {
+				print_usage();
+			}
+			config.capture_cycles = (uint32_t)capture_cycles;
+		} else if (strcmp(argv[i], "--generator") == 0) {
+			if (strcmp(argv[i + 1], "random") == 0) {
+				config.coverage_guided = false;
+			} else if (strcmp(argv[i + 1], "coverage") == 0) {
+				config.coverage_guided = true;
+			} else {
+				print_usage();
+			}
+		} else {
+			print_usage();
 		}
 	}
 
-	std::cout << "usage: testbench [--rerun <test-file>] [--run <num-tests>]\n";
-	exit(-1);
-	return { };
+	if (config.num_tests == 0) {
+		print_usage();
+	}
+
+	return config;
+}
+
+// Shrink the failing test in config.minimize_test_file, and save the result to minimized.bin.
+int minimize(Config const &config) {
+	Test test;
+	test.load(config.minimize_test_file);
+
+	TestMinimizer minimizer(test);
+	minimizer.set_write_pacing(config.write_pacing, config.bus_latency);
+	minimizer.set_row_drain(config.row_drain);
+	minimizer.set_status_wait(config.status_wait);
+
+	size_t const original_instructions = minimizer.instruction_count();
+	if (!minimizer.minimize()) {
+		std::cout << config.minimize_test_file << " passes, nothing to minimize\n";
+		return -1;
+	}
+
+	Test minimized = minimizer.minimized_test();
+	minimized.save("minimized.bin");
+
+	FailureSignature const &failure = minimizer.failure_signature();
+	std::cout << "minimized " << original_instructions << " instructions to " <<
+		minimizer.instruction_count() << " in " << minimizer.tests_run_count() <<
+		" runs, still failing on " << failure.check;
+	if (failure.dut_status != failure.ref_status) {
+		std::cout << " (0x" << std::hex << failure.dut_status << " (dut) != 0x" << failure.ref_status << " (ref))" <<
+			std::dec;
+	}
+	std::cout << ", written to minimized.bin\n";
+
+	return 0;
 }
 
 int main(int argc, char **argv) {
 	Config config = parse_arguments(argc, argv);
 
+	if (config.minimize_test_file) {
+		return minimize(config);
+	}
+
 	std::unique_ptr<TestGenerator> test_generator;
 	if (config.rerun_test_file) {
 		test_generator = std::make_unique<ReplayTestGenerator>(config.rerun_test_file);
+	} else if (config.coverage_guided) {
+		test_generator = std::make_unique<CoverageTestGenerator>(config.num_tests);
 	} else {
 		test_generator = std::make_unique<RandomTestGenerator>(config.num_tests);
 	}
 
-	Testbench testbench;
+	char const *failure_file = config.rerun_test_file ? nullptr : "test.bin";
+	TestRunner runner(test_generator.get(), config.num_jobs, failure_file);
+	runner.set_write_pacing(config.write_pacing, config.bus_latency);
+	runner.set_row_drain(config.row_drain);
+	runner.set_status_wait(config.status_wait);
+	runner.set_capture(config.capture_cycles, "failure.vcd");
 
-	uint32_t test_count = 0;
-	while (test_generator->has_tests()) {
-		std::cout << "running test " << ++test_count << "...";
-		std::unique_ptr<Test> test = test_generator->next_test();
-		bool passed = testbench.run_test(test.get());
-		if (passed) {
-			std::cout << " passed\n";
-		} else {
-			std::cout << "TEST FAILED\n";
-			if (config.rerun_test_file == nullptr) {
-				test->save("test.bin");
-			}
-			return -1;
-		}
+	// Sampling coverage costs time every cycle, so it's only done when something is guided by it.
+	runner.set_coverage(config.coverage_guided && !config.rerun_test_file);
+
+	auto const start_time = std::chrono::steady_clock::now();
+	bool passed = runner.run();
+	std::chrono::duration<double> const elapsed = std::chrono::steady_clock::now() - start_time;
+
+	print_summary(runner.summary(elapsed.count()));
+
+	if (!passed) {
+		return -1;
 	}
 
 	std::cout << "ALL TESTS PASSED\n";
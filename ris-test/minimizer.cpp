@@ -0,0 +1,111 @@
+#include <algorithm>
+
+#include "minimizer.h"
+
+// Split the program into instructions, using the reference model to find where each one ends.
+TestMinimizer::TestMinimizer(Test const &test) :
+	program_header(test.program_header),
+	tests_run(0) {
+	Test program = test;
+	SoftwareSim swsim;
+	swsim.set_program(&program);
+
+	size_t start = 0;
+	bool last_is_end_sequence = false;
+	while (start < program.program.size()) {
+		swsim.resume();
+		swsim.step_instruction();
+		size_t const end = std::min(swsim.instruction_offset(), program.program.size());
+		instructions.emplace_back(program.program.begin() + start, program.program.begin() + end);
+		last_is_end_sequence = swsim.end_sequence;
+		start = end;
+	}
+
+	if (last_is_end_sequence) {
+		end_sequence = std::move(instructions.back());
+		instructions.pop_back();
+	}
+
+	testbench.set_quiet(true);
+}
+
+// Run ddmin over the instructions, keeping the smallest set of instructions found that still fails
+// the way the original test did. Returns false if the original test doesn't fail, in which case
+// there is nothing to minimize.
+bool TestMinimizer::minimize() {
+	Test test = build_test(instructions);
+	tests_run += 1;
+	if (testbench.run_test(&test)) {
+		return false;
+	}
+	failure = testbench.failure_signature();
+
+	size_t num_parts = 2;
+	while (instructions.size() >= 2) {
+		size_t const size      = instructions.size();
+		size_t const part_size = (size + num_parts - 1) / num_parts;
+		bool reduced           = false;
+
+		// Try each part on its own, then each part's complement.
+		for (size_t part = 0; part < num_parts && !reduced; ++part) {
+			size_t const part_start = std::min(part * part_size, size);
+			size_t const part_end   = std::min(part_start + part_size, size);
+			if (part_start == part_end) {
+				continue;
+			}
+			std::vector<std::vector<uint8_t>> const subset(instructions.begin() + part_start,
+				instructions.begin() + part_end);
+			if (fails(subset)) {
+				instructions = subset;
+				num_parts    = 2;
+				reduced      = true;
+			}
+		}
+		for (size_t part = 0; part < num_parts && !reduced; ++part) {
+			size_t const part_start = std::min(part * part_size, size);
+			size_t const part_end   = std::min(part_start + part_size, size);
+			if (part_start == part_end) {
+				continue;
+			}
+			std::vector<std::vector<uint8_t>> complement(instructions.begin(), instructions.begin() + part_start);
+			complement.insert(complement.end(), instructions.begin() + part_end, instructions.end());
+			if (fails(complement)) {
+				instructions = complement;
+				num_parts    = std::max<size_t>(num_parts - 1, 2);
+				reduced      = true;
+			}
+		}
+
+		if (!reduced) {
+			if (num_parts >= size) {
+				break;
+			}
+			num_parts = std::min(num_parts * 2, size);
+		}
+	}
+
+	// A single remaining instruction may not be needed at all.
+	if (instructions.size() == 1 && fails({ })) {
+		instructions.clear();
+	}
+
+	return true;
+}
+
+// Whether the candidate fails with the original test's failure signature. A candidate that fails
+// some other way is rejected, since it may be a different bug.
+bool TestMinimizer::fails(std::vector<std::vector<uint8_t>> const &candidate) {
+	Test test = build_test(candidate);
+	tests_run += 1;
+	return !testbench.run_test(&test) && testbench.failure_signature() == failure;
+}
+
+Test TestMinimizer::build_test(std::vector<std::vector<uint8_t>> const &candidate) const {
+	Test test;
+	test.program_header = program_header;
+	for (std::vector<uint8_t> const &instruction : candidate) {
+		test.program.insert(test.program.end(), instruction.begin(), instruction.end());
+	}
+	test.program.insert(test.program.end(), end_sequence.begin(), end_sequence.end());
+	return test;
+}
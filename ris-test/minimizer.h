@@ -0,0 +1,50 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include "sim.h"
+#include "test.h"
+#include "testbench.h"
+
+// Shrinks a failing test to a smaller one that still fails the same way, by delta debugging over
+// the instructions of its program. The end sequence at the end of the program is always kept.
+class TestMinimizer
+{
+	Testbench testbench;
+
+	uint32_t program_header;
+	std::vector<std::vector<uint8_t>> instructions;
+	std::vector<uint8_t> end_sequence;
+
+	// How the original test failed, which every smaller test must match.
+	FailureSignature failure;
+
+	uint32_t tests_run;
+
+public:
+	TestMinimizer(Test const &test);
+
+	void set_write_pacing(WritePacing write_pacing, uint32_t bus_latency) {
+		testbench.set_write_pacing(write_pacing, bus_latency);
+	}
+
+	void set_row_drain(RowDrain row_drain) {
+		testbench.set_row_drain(row_drain);
+	}
+
+	void set_status_wait(StatusWait status_wait) {
+		testbench.set_status_wait(status_wait);
+	}
+
+	bool minimize();
+	Test minimized_test() const { return build_test(instructions); }
+	FailureSignature const &failure_signature() const { return failure; }
+
+	size_t instruction_count() const { return instructions.size(); }
+	uint32_t tests_run_count() const { return tests_run; }
+
+private:
+	bool fails(std::vector<std::vector<uint8_t>> const &candidate);
+	Test build_test(std::vector<std::vector<uint8_t>> const &candidate) const;
+};
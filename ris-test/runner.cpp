@@ -0,0 +1,169 @@
+#include <chrono>
+#include <iostream>
+#include <thread>
+#include <vector>
+
+#include "runner.h"
+#include "testbench.h"
+
+TestRunner::TestRunner(TestGenerator *test_generator_in, uint32_t num_jobs_in, char const *failure_file_name_in) :
+	test_generator(test_generator_in),
+	failure_file_name(failure_file_name_in),
+	num_jobs(num_jobs_in),
+	write_pacing(WRITE_PACING_FIXED),
+	bus_latency(FIXED_WRITE_PACING_CYCLES),
+	row_drain(ROW_DRAIN_REGISTERS),
+	status_wait(STATUS_WAIT_POLL),
+	capture_cycles(0),
+	capture_file_name(nullptr),
+	coverage(false),
+	failed(false),
+	tests_run(0),
+	tests_passed(0),
+	cycles(0),
+	wasted_cycles(0) {
+}
+
+void TestRunner::set_write_pacing(WritePacing write_pacing_in, uint32_t bus_latency_in) {
+	write_pacing = write_pacing_in;
+	bus_latency  = bus_latency_in;
+}
+
+// Keep the last capture_cycles cycles of the peripheral's ports and internal state, and write them
+// to capture_file_name if a test fails. A capture_cycles of 0 disables the capture.
+void TestRunner::set_capture(uint32_t capture_cycles_in, char const *capture_file_name_in) {
+	capture_cycles    = capture_cycles_in;
+	capture_file_name = capture_file_name_in;
+}
+
+bool TestRunner::run() {
+	if (num_jobs <= 1) {
+		run_serial();
+	} else {
+		std::vector<std::thread> workers;
+		for (uint32_t i = 0; i < num_jobs; ++i) {
+			workers.emplace_back(&TestRunner::run_worker, this);
+		}
+		for (std::thread &worker : workers) {
+			worker.join();
+		}
+	}
+	return !failed;
+}
+
+RunSummary TestRunner::summary(double seconds) {
+	return { tests_run, tests_passed, cycles, wasted_cycles, coverage, total_coverage.count(), seconds };
+}
+
+void TestRunner::run_serial() {
+	Testbench testbench;
+	testbench.set_write_pacing(write_pacing, bus_latency);
+	testbench.set_row_drain(row_drain);
+	testbench.set_status_wait(status_wait);
+	testbench.set_capture(capture_cycles);
+	testbench.set_coverage(coverage);
+
+	while (std::unique_ptr<Test> test = next_test()) {
+		std::cout << "running test " << ++tests_run << "...";
+		bool passed = testbench.run_test(test.get());
+		if (coverage) {
+			report_coverage(test.get(), testbench);
+		}
+		if (passed) {
+			std::cout << " passed\n";
+			tests_passed += 1;
+		} else {
+			std::cout << "TEST FAILED\n";
+			report_failure(test.get(), testbench);
+			break;
+		}
+	}
+
+	collect_cycles(testbench);
+}
+
+void TestRunner::run_worker() {
+	// Each worker owns its own testbench, and therefore its own verilator context and model, so
+	// the only state shared between workers is the test generator and the counters.
+	Testbench testbench;
+	testbench.set_write_pacing(write_pacing, bus_latency);
+	testbench.set_row_drain(row_drain);
+	testbench.set_status_wait(status_wait);
+	testbench.set_capture(capture_cycles);
+	testbench.set_coverage(coverage);
+
+	while (!failed) {
+		std::unique_ptr<Test> test = next_test();
+		if (!test) {
+			break;
+		}
+		tests_run += 1;
+		bool passed = testbench.run_test(test.get());
+		if (coverage) {
+			report_coverage(test.get(), testbench);
+		}
+		if (passed) {
+			tests_passed += 1;
+		} else {
+			report_failure(test.get(), testbench);
+			break;
+		}
+	}
+
+	collect_cycles(testbench);
+}
+
+std::unique_ptr<Test> TestRunner::next_test() {
+	std::lock_guard<std::mutex> lock(test_generator_mutex);
+	if (failed || !test_generator->has_tests()) {
+		return nullptr;
+	}
+	return test_generator->next_test();
+}
+
+// Add the coverage reached by a test to the total, and tell the test generator whether the test
+// reached anything new, so that it can build on the tests that did.
+void TestRunner::report_coverage(Test const *test, Testbench const &testbench) {
+	std::lock_guard<std::mutex> lock(test_generator_mutex);
+	bool const new_coverage = total_coverage.merge(testbench.coverage()) > 0;
+	test_generator->report_coverage(test, new_coverage);
+}
+
+void TestRunner::report_failure(Test *test, Testbench const &testbench) {
+	// Only the first failing worker saves its test, so that test.bin always holds a single,
+	// complete reproducer even if several workers fail at around the same time.
+	if (failed.exchange(true)) {
+		return;
+	}
+	if (num_jobs > 1) {
+		std::cout << "TEST FAILED\n";
+	}
+	if (failure_file_name) {
+		test->save(failure_file_name);
+	}
+	if (capture_cycles > 0 && capture_file_name && testbench.write_capture(capture_file_name)) {
+		std::cout << "last " << capture_cycles << " cycles written to " << capture_file_name << "\n";
+	}
+}
+
+void TestRunner::collect_cycles(Testbench const &testbench) {
+	cycles        += testbench.cycle_count();
+	wasted_cycles += testbench.wasted_cycle_count();
+}
+
+void print_summary(RunSummary const &summary) {
+	std::cout << summary.tests_passed << "/" << summary.tests_run << " tests passed in " <<
+		summary.seconds << "s";
+	if (summary.seconds > 0.0) {
+		std::cout << " (" << (uint64_t)(summary.tests_run / summary.seconds) << " tests/s, " <<
+			(uint64_t)(summary.cycles / summary.seconds) << " cycles/s)";
+	}
+	std::cout << '\n';
+	if (summary.coverage) {
+		std::cout << summary.coverage_points << " of " << COVERAGE_POINTS << " coverage points reached\n";
+	}
+	if (summary.wasted_cycles > 0) {
+		std::cout << summary.wasted_cycles << " of " << (summary.cycles + summary.wasted_cycles) <<
+			" cycles would have been spent idle under fixed pacing at the same bus latency\n";
+	}
+}
@@ -0,0 +1,71 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+#include <memory>
+
+#include "sim.h"
+#include "testgen.h"
+
+class Test;
+class Testbench;
+
+struct RunSummary
+{
+	uint64_t tests_run;
+	uint64_t tests_passed;
+	uint64_t cycles;
+	uint64_t wasted_cycles;
+	bool coverage;
+	uint32_t coverage_points;
+	double seconds;
+};
+
+class TestRunner
+{
+	TestGenerator *test_generator;
+	std::mutex test_generator_mutex;
+
+	char const *failure_file_name;
+	uint32_t num_jobs;
+
+	WritePacing write_pacing;
+	uint32_t bus_latency;
+	RowDrain row_drain;
+	StatusWait status_wait;
+	uint32_t capture_cycles;
+	char const *capture_file_name;
+	bool coverage;
+
+	std::atomic<bool> failed;
+	std::atomic<uint64_t> tests_run;
+	std::atomic<uint64_t> tests_passed;
+	std::atomic<uint64_t> cycles;
+	std::atomic<uint64_t> wasted_cycles;
+
+	// Coverage points reached by every test so far, guarded by test_generator_mutex.
+	Coverage total_coverage;
+
+public:
+	TestRunner(TestGenerator *test_generator_in, uint32_t num_jobs_in, char const *failure_file_name_in);
+
+	void set_write_pacing(WritePacing write_pacing_in, uint32_t bus_latency_in);
+	void set_row_drain(RowDrain row_drain_in) { row_drain = row_drain_in; }
+	void set_status_wait(StatusWait status_wait_in) { status_wait = status_wait_in; }
+	void set_capture(uint32_t capture_cycles_in, char const *capture_file_name_in);
+	void set_coverage(bool coverage_in) { coverage = coverage_in; }
+
+	bool run();
+	RunSummary summary(double seconds);
+
+private:
+	void run_serial();
+	void run_worker();
+	std::unique_ptr<Test> next_test();
+	void report_coverage(Test const *test, Testbench const &testbench);
+	void report_failure(Test *test, Testbench const &testbench);
+	void collect_cycles(Testbench const &testbench);
+};
+
+void print_summary(RunSummary const &summary);
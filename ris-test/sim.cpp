@@ -1,6 +1,10 @@
 #include "sim.h"
 
+#if VM_TRACE
 #include "verilated_vcd_c.h"
+#endif
+
+#include "../tools/common/leb128.h"
 
 void SoftwareSim::set_program(Test *test_in) {
 	test = test_in;
@@ -122,41 +126,15 @@ bool SoftwareSim::program_finished() {
 }
 
 uint32_t SoftwareSim::read_uleb() {
-	uint32_t result = 0;
-	uint32_t shift = 0;
-	uint8_t byte;
-	do {
-		byte = test->program[ip++];
-		if (shift < 31) {
-			result |= (byte & 0x7F) << shift;
-			shift  += 7;
-		}
-	} while ((byte & 0x80) != 0);
+	uint64_t result;
+	ip += decode_uleb(test->program.data() + ip, result);
 	return result & 0xFFFFFFF;
 }
 
 int32_t SoftwareSim::read_sleb() {
-	uint32_t result = 0;
-	uint32_t shift = 0;
-	uint8_t byte;
-	do {
-		byte = test->program[ip++];
-		if (shift < 31) {
-			result |= (byte & 0x7F) << shift;
-			shift  += 7;
-		}
-	} while ((byte & 0x80) != 0);
-	if (shift < 31) {
-		bool sign_bit = ((result >> (shift - 1)) & 1) == 1;
-		if (sign_bit) {
-			uint32_t sign_mask = 0xffffffff << shift;
-			result |= sign_mask;
-		}
-	}
-
-	int32_t out_result;
-	memcpy(&out_result, &result, sizeof(out_result));
-	return out_result;
+	int64_t result;
+	ip += decode_sleb(test->program.data() + ip, result);
+	return (int32_t)result;
 }
 
 uint32_t SoftwareSim::read_u16() {
@@ -173,77 +151,101 @@ uint32_t SoftwareSim::read_u32() {
 	return result;
 }
 
-HardwareSim::HardwareSim() {
-	Verilated::traceEverOn(true);
-
-	verilator_sim = std::make_unique<Vtqvp_laurie_dwarf_line_table_accelerator>();
-	verilator_sim->clk          = 0;
-	verilator_sim->rst_n        = 0;
-	verilator_sim->ui_in        = 0;
-	verilator_sim->address      = 0;
-	verilator_sim->data_in      = 0;
-	verilator_sim->data_write_n = 3;
-	verilator_sim->data_read_n  = 3;
-	run_cycle();
-	verilator_sim->rst_n = 1;
-	run_cycle();
-}
+void HardwareSim::set_program(Test *test_in) {
+	test     = test_in;
+	ip       = 0;
+	prev_row = ROW_DELTA_INITIAL_ROW;
 
-HardwareSim::~HardwareSim() {
-	verilator_sim->final();
+	if (status_wait == STATUS_WAIT_INTERRUPT) {
+		set_int_mask(INT_MASK_ALL);
+	}
+	bus.write_dword(PROGRAM_HEADER, test->program_header);
 }
 
-void HardwareSim::set_program(Test *test_in) {
-	test = test_in;
-	ip   = 0;
-
-	write_dword(PROGRAM_HEADER, test->program_header);
+// Configure the hardware row filter, which applies to the rows of the next program set. A
+// filter_ctrl of 0 reports every row.
+void HardwareSim::set_row_filter(uint32_t filter_lo, uint32_t filter_hi, uint32_t filter_ctrl) {
+	bus.write_dword(FILTER_LO, filter_lo);
+	bus.write_dword(FILTER_HI, filter_hi);
+	bus.write_dword(FILTER_CTRL, filter_ctrl);
 }
 
+// Stream code into the program code FIFO until the accelerator emits a row or hits an illegal
+// instruction, or has consumed the whole program. Each poll of STATUS is followed by a burst of as
+// many writes as there are free FIFO entries, rather than a single write. When waiting on the
+// interrupt, STATUS is only read once the interrupt is raised.
 bool HardwareSim::run_to_emit_row_or_illegal() {
+	// The timeout only counts polls in a row that make no progress, i.e. that neither write a chunk
+	// nor see the FIFO level change, so long programs aren't cut short by the time they take.
+	int timeout = 1000;
+	uint32_t fifo_level = ~0u;
 	while (true) {
-		int timeout     = 1000;
-		uint32_t status = read_dword(STATUS);
-		while (status == STATUS_BUSY) {
-			status = read_dword(STATUS);
-			if (--timeout == 0) {
-				return false;
-			}
+		if (status_wait == STATUS_WAIT_INTERRUPT && !bus.wait_for_interrupt()) {
+			return false;
 		}
+
+		uint32_t const status = bus.read_dword(STATUS) & STATUS_CODE_MASK;
 		if (status == STATUS_EMIT_ROW || status == STATUS_ILLEGAL) {
 			break;
 		}
-		write_next();
+		if (program_finished() && status == STATUS_READY) {
+			break;
+		}
+
+		uint32_t const code_fifo = bus.read_dword(CODE_FIFO);
+		uint32_t const level     = (code_fifo >> CODE_FIFO_LEVEL_SHIFT) & CODE_FIFO_LEVEL_MASK;
+		uint32_t const writes    = write_burst(code_fifo & CODE_FIFO_FREE_MASK);
+		if (writes > 0 || level != fifo_level) {
+			timeout = 1000;
+		} else if (--timeout == 0) {
+			return false;
+		}
+		fifo_level = level;
+
+		// Once the whole program is written, the code space source would hold the interrupt raised
+		// while the FIFO drains, so it is disabled, leaving ready to report the end of the program.
+		if ((int_mask & INT_MASK_CODE) != 0 && program_finished()) {
+			set_int_mask(int_mask & ~INT_MASK_CODE);
+		}
 	}
 	return true;
 }
 
-void HardwareSim::resume() {
-	write_dword(STATUS, 0);
+void HardwareSim::set_status_wait(StatusWait status_wait_in) {
+	status_wait = status_wait_in;
+	set_int_mask(status_wait == STATUS_WAIT_INTERRUPT ? INT_MASK_ALL : 0);
 }
 
-uint32_t HardwareSim::read_dword(uint8_t reg) {
-	verilator_sim->address     = reg;
-	verilator_sim->data_read_n = 2;
-	run_cycle();
-	verilator_sim->data_write_n = 3;
-	while (!verilator_sim->data_ready) {
-		run_cycle();
+void HardwareSim::set_int_mask(uint32_t int_mask_in) {
+	if (int_mask_in != int_mask) {
+		int_mask = int_mask_in;
+		bus.write_dword(INT_MASK, int_mask);
 	}
-	return verilator_sim->data_out;
 }
 
-void HardwareSim::run_cycles(uint32_t cycles) {
-	for (uint32_t i = 0; i < cycles; ++i) {
-		run_cycle();
-	}
+void HardwareSim::resume() {
+	bus.write_dword(ROW_POP, 0);
 }
 
-void HardwareSim::run_cycle() {
-	verilator_sim->eval();
-	verilator_sim->clk = 1;
-	verilator_sim->eval();
-	verilator_sim->clk = 0;
+// Read and pop the row at the head of the row queue the way a driver would, using the row drain
+// strategy set.
+LineTableRow HardwareSim::drain_row() {
+	LineTableRow const row = bus.pop_row(row_drain, prev_row);
+	prev_row = row.end_sequence ? ROW_DELTA_INITIAL_ROW : row;
+	return row;
+}
+
+bool HardwareSim::program_finished() {
+	return ip >= test->program.size();
+}
+
+// Fill the free entries of the program code FIFO, returning the number of writes made.
+uint32_t HardwareSim::write_burst(uint32_t free_entries) {
+	uint32_t writes = 0;
+	for (; writes < free_entries && !program_finished(); ++writes) {
+		write_next();
+	}
+	return writes;
 }
 
 void HardwareSim::write_next() {
@@ -252,51 +254,24 @@ void HardwareSim::write_next() {
 		if (remaining >= 4) {
 			uint32_t dword;
 			memcpy(&dword, test->program.data() + ip, 4);
-			write_dword(PROGRAM_CODE, dword);
+			bus.write_dword(PROGRAM_CODE, dword);
 			ip += 4;
 		} else if (remaining >= 2) {
 			uint16_t word;
 			memcpy(&word, test->program.data() + ip, 2);
-			write_word(PROGRAM_CODE, word);
+			bus.write_word(PROGRAM_CODE, word);
 			ip += 2;
 		} else {
-			write_byte(PROGRAM_CODE, test->program[ip]);
+			bus.write_byte(PROGRAM_CODE, test->program[ip]);
 			ip += 1;
 		}
 	} else {
-		run_cycle();
+		bus.run_cycle();
 	}
 }
 
-void HardwareSim::write_dword(uint8_t reg, uint32_t dword) {
-	verilator_sim->address      = reg;
-	verilator_sim->data_in      = dword;
-	verilator_sim->data_write_n = 2;
-	run_cycle();
-	verilator_sim->data_write_n = 3;
-	run_cycles(8);
-}
-
-void HardwareSim::write_word(uint8_t reg, uint16_t word) {
-	verilator_sim->address = reg;
-	verilator_sim->data_in = word;
-	verilator_sim->data_write_n = 1;
-	run_cycle();
-	verilator_sim->data_write_n = 3;
-	run_cycles(8);
-}
-
-void HardwareSim::write_byte(uint8_t reg, uint8_t byte) {
-	verilator_sim->address = reg;
-	verilator_sim->data_in = byte;
-	verilator_sim->data_write_n = 0;
-	run_cycle();
-	verilator_sim->data_write_n = 3;
-	run_cycles(8);
-}
-
 double sc_time_stamp() {
-	static double time_counter = 0.0;
+	static thread_local double time_counter = 0.0;
 	time_counter += 1.0;
 	return time_counter;
 }
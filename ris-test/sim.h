@@ -3,15 +3,10 @@
 #include <cstdint>
 #include <memory>
 
-#include "Vtqvp_laurie_dwarf_line_table_accelerator.h"
+#include "../tools/common/bus.h"
 
 #include "test.h"
 
-#define STATUS_READY    0x0
-#define STATUS_EMIT_ROW 0x1
-#define STATUS_BUSY     0x2
-#define STATUS_ILLEGAL  0x3
-
 #define DW_LNS_COPY             0x01
 #define DW_LNS_ADVANCEPC        0x02
 #define DW_LNS_ADVANCELINE      0x03
@@ -30,14 +25,6 @@
 #define DW_LNE_SETADDRESS       0x02
 #define DW_LNE_SETDISCRIMINATOR 0x04
 
-#define PROGRAM_HEADER    0x00
-#define PROGRAM_CODE      0x04
-#define AM_ADDRESS        0x08
-#define AM_FILE_DISCRIM   0x0C
-#define AM_LINE_COL_FLAGS 0x10
-#define STATUS            0x14
-#define INFO              0x18
-
 class SoftwareSim
 {
 	Test *test;
@@ -71,6 +58,7 @@ public:
 	void resume();
 	void step_instruction();
 	bool program_finished();
+	size_t instruction_offset() const { return ip; }
 
 private:
 	uint32_t read_uleb();
@@ -81,27 +69,44 @@ private:
 
 class HardwareSim
 {
-	std::unique_ptr<Vtqvp_laurie_dwarf_line_table_accelerator> verilator_sim;
+	Bus bus;
 
 	Test *test;
 
 	size_t ip;
 
-public:
-	HardwareSim();
-	~HardwareSim();
+	StatusWait status_wait = STATUS_WAIT_POLL;
+	uint32_t int_mask      = 0;
+
+	RowDrain row_drain = ROW_DRAIN_REGISTERS;
+	LineTableRow prev_row;
 
+public:
 	void set_program(Test *test_in);
+	void set_row_filter(uint32_t filter_lo, uint32_t filter_hi, uint32_t filter_ctrl);
 	bool run_to_emit_row_or_illegal();
 	void resume();
+	LineTableRow drain_row();
+	bool program_finished();
+
+	uint32_t read_dword(uint8_t reg) { return bus.read_dword(reg); }
+
+	void set_write_pacing(WritePacing write_pacing, uint32_t bus_latency) {
+		bus.set_write_pacing(write_pacing, bus_latency);
+	}
+	void set_status_wait(StatusWait status_wait_in);
+	void set_row_drain(RowDrain row_drain_in) { row_drain = row_drain_in; }
+	void set_capture(uint32_t cycles) { bus.set_capture(cycles); }
+	bool write_capture(char const *file_name) const { return bus.write_capture(file_name); }
+	void set_coverage(Coverage *coverage) { bus.set_coverage(coverage); }
 
-	uint32_t read_dword(uint8_t reg);
+	uint64_t cycle_count() const { return bus.cycle_count(); }
+	uint64_t wasted_cycle_count() const { return bus.wasted_cycle_count(); }
+	uint64_t bus_transaction_count() const { return bus.bus_transaction_count(); }
+	uint64_t status_read_count() const { return bus.status_read_count(); }
 
 private:
-	void run_cycles(uint32_t cycles);
-	void run_cycle();
+	void set_int_mask(uint32_t int_mask_in);
+	uint32_t write_burst(uint32_t free_entries);
 	void write_next();
-	void write_dword(uint8_t reg, uint32_t dword);
-	void write_word(uint8_t reg, uint16_t word);
-	void write_byte(uint8_t reg, uint8_t byte);
 };
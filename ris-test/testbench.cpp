@@ -1,21 +1,62 @@
 #include <iostream>
 
+#include "../tools/common/line_decoder.h"
+
 #include "testbench.h"
 
+static bool rows_equal(LineTableRow const &a, LineTableRow const &b) {
+	return a.address == b.address && a.file == b.file && a.line == b.line && a.column == b.column &&
+		a.discriminator == b.discriminator && a.is_stmt == b.is_stmt && a.basic_block == b.basic_block &&
+		a.end_sequence == b.end_sequence && a.prologue_end == b.prologue_end &&
+		a.epilogue_begin == b.epilogue_begin;
+}
+
+// The row filter settings for a test are derived from a hash of the test, so that a failing test
+// is replayed with the same filter.
+static uint32_t hash_test(Test const *test) {
+	uint32_t hash = 2166136261u;
+	for (int i = 0; i < 4; ++i) {
+		hash = (hash ^ ((test->program_header >> (i * 8)) & 0xFF)) * 16777619u;
+	}
+	for (uint8_t byte : test->program) {
+		hash = (hash ^ byte) * 16777619u;
+	}
+	return hash;
+}
+
 bool Testbench::run_test(Test *test) {
+	failure = FailureSignature { };
+	test_coverage.clear();
 	hwsim.set_program(test);
 	swsim.set_program(test);
+	reference_rows.clear();
 	while (true) {
 		swsim.run_to_emit_row_or_illegal();
 		if (!hwsim.run_to_emit_row_or_illegal()) {
-			std::cerr << "\nmismatch - hardware timeout\n";
-			break;
+			mismatch_log << "\nmismatch - hardware timeout\n";
+			return mismatch("hardware timeout");
 		}
 		if (compare_state()) {
+			if (swsim.status == STATUS_EMIT_ROW) {
+				LineTableRow row;
+				row.address        = swsim.address;
+				row.file           = swsim.file;
+				row.line           = swsim.line;
+				row.column         = swsim.column;
+				row.discriminator  = swsim.discriminator;
+				row.is_stmt        = swsim.is_stmt;
+				row.basic_block    = swsim.basic_block_start;
+				row.end_sequence   = swsim.end_sequence;
+				row.prologue_end   = swsim.prologue_end;
+				row.epilogue_begin = swsim.epiloque_begin;
+				reference_rows.push_back(row);
+				if (!pop_row()) {
+					break;
+				}
+			}
 			if (swsim.program_finished()) {
-				return true;
+				return compare_final_state() && compare_decoder(test) && compare_row_filter(test);
 			}
-			hwsim.resume();
 			swsim.resume();
 		} else {
 			break;
@@ -26,11 +67,13 @@ bool Testbench::run_test(Test *test) {
 }
 
 bool Testbench::compare_state() {
-	uint32_t status         = hwsim.read_dword(STATUS);
+	uint32_t status_fields  = hwsim.read_dword(STATUS);
 	uint32_t address        = hwsim.read_dword(AM_ADDRESS);
 	uint32_t file_discrim   = hwsim.read_dword(AM_FILE_DISCRIM);
 	uint32_t line_col_flags = hwsim.read_dword(AM_LINE_COL_FLAGS);
 
+	uint32_t status        = status_fields & STATUS_CODE_MASK;
+	uint32_t queued_rows   = (status_fields >> STATUS_ROW_QUEUE_SHIFT) & STATUS_ROW_QUEUE_MASK;
 	uint16_t file          = file_discrim & 0xFFFF;
 	uint16_t line          = line_col_flags & 0xFFFF;
 	uint16_t column        = (line_col_flags >> 16) & 0x3FF;
@@ -42,49 +85,225 @@ bool Testbench::compare_state() {
 	uint16_t discriminator = file_discrim >> 16;
 
 	if (status != swsim.status) {
-		std::cerr << "\nmismatch on status: 0x" << std::hex << status << " (dut) != 0x" << (uint32_t)swsim.status << " (ref)\n";
-		return false;
+		mismatch_log << "\nmismatch on status: 0x" << std::hex << status << " (dut) != 0x" << (uint32_t)swsim.status << " (ref)\n";
+		return mismatch("status", status, swsim.status);
+	}
+	// The hardware keeps running ahead of the reference model while rows are queued, so the
+	// AM registers must show the row at the head of the queue, which is the row emitted by the
+	// reference model.
+	if ((queued_rows != 0) != (status == STATUS_EMIT_ROW)) {
+		mismatch_log << "\nmismatch on queued rows: " << std::dec << queued_rows << " with status 0x" << std::hex << status << " (dut)\n";
+		return mismatch("queued rows");
 	}
 	if (address != swsim.address) {
-		std::cerr << "\nmismatch on address: 0x" << std::hex << address << " (dut) != 0x" << swsim.address << " (ref)\n";
-		return false;
+		mismatch_log << "\nmismatch on address: 0x" << std::hex << address << " (dut) != 0x" << swsim.address << " (ref)\n";
+		return mismatch("address");
 	}
 	if (file != swsim.file) {
-		std::cerr << "\nmismatch on file: 0x" << std::hex << file << " (dut) != 0x" << swsim.file << " (ref)\n";
-		return false;
+		mismatch_log << "\nmismatch on file: 0x" << std::hex << file << " (dut) != 0x" << swsim.file << " (ref)\n";
+		return mismatch("file");
 	}
 	if (line != swsim.line) {
-		std::cerr << "\nmismatch on line: 0x" << std::hex << line << " (dut) != 0x" << swsim.line << " (ref)\n";
-		return false;
+		mismatch_log << "\nmismatch on line: 0x" << std::hex << line << " (dut) != 0x" << swsim.line << " (ref)\n";
+		return mismatch("line");
 	}
 	if (column != swsim.column) {
-		std::cerr << "\nmismatch on column: 0x" << std::hex << column << " (dut) != 0x" << swsim.column << " (ref)\n";
-		return false;
+		mismatch_log << "\nmismatch on column: 0x" << std::hex << column << " (dut) != 0x" << swsim.column << " (ref)\n";
+		return mismatch("column");
 	}
 	if (is_stmt != swsim.is_stmt) {
-		std::cerr << "\nmismatch on is_stmt: " << is_stmt << " (dut) != " << swsim.is_stmt << " (ref)\n";
-		return false;
+		mismatch_log << "\nmismatch on is_stmt: " << is_stmt << " (dut) != " << swsim.is_stmt << " (ref)\n";
+		return mismatch("is_stmt");
 	}
 	if (basic_block_start != swsim.basic_block_start) {
-		std::cerr << "\nmismatch on basic_block_start: " << basic_block_start << " (dut) != " << swsim.basic_block_start << " (ref)\n";
-		return false;
+		mismatch_log << "\nmismatch on basic_block_start: " << basic_block_start << " (dut) != " << swsim.basic_block_start << " (ref)\n";
+		return mismatch("basic_block_start");
 	}
 	if (end_sequence != swsim.end_sequence) {
-		std::cerr << "\nmismatch on end_sequence: " << end_sequence << " (dut) != " << swsim.end_sequence << " (ref)\n";
-		return false;
+		mismatch_log << "\nmismatch on end_sequence: " << end_sequence << " (dut) != " << swsim.end_sequence << " (ref)\n";
+		return mismatch("end_sequence");
 	}
 	if (prologue_end != swsim.prologue_end) {
-		std::cerr << "\nmismatch on prologue_end: " << prologue_end << " (dut) != " << swsim.prologue_end << " (ref)\n";
-		return false;
+		mismatch_log << "\nmismatch on prologue_end: " << prologue_end << " (dut) != " << swsim.prologue_end << " (ref)\n";
+		return mismatch("prologue_end");
 	}
 	if (epiloque_begin != swsim.epiloque_begin) {
-		std::cerr << "\nmismatch on epiloque_begin: " << epiloque_begin << " (dut) != " << swsim.epiloque_begin << " (ref)\n";
-		return false;
+		mismatch_log << "\nmismatch on epiloque_begin: " << epiloque_begin << " (dut) != " << swsim.epiloque_begin << " (ref)\n";
+		return mismatch("epiloque_begin");
 	}
 	if (discriminator != swsim.discriminator) {
-		std::cerr << "\nmismatch on discriminator: 0x" << std::hex << discriminator << " (dut) != 0x" << swsim.discriminator << " (ref)\n";
-		return false;
+		mismatch_log << "\nmismatch on discriminator: 0x" << std::hex << discriminator << " (dut) != 0x" << swsim.discriminator << " (ref)\n";
+		return mismatch("discriminator");
+	}
+
+	return true;
+}
+
+// Record the check a test failed on, and for the checks on STATUS, the status codes of the hardware
+// and the reference model.
+bool Testbench::mismatch(char const *check, uint32_t dut_status, uint32_t ref_status) {
+	failure = { check, dut_status, ref_status };
+	return false;
+}
+
+// Pop the row the reference model has just emitted from the hardware. With ROW_DRAIN_DELTA, the row
+// is read back through ROW_DELTA, which pops it, and the row rebuilt from the delta must match the
+// reference model's row as well as the AM registers already compared.
+bool Testbench::pop_row() {
+	if (row_drain == ROW_DRAIN_REGISTERS) {
+		hwsim.resume();
+		return true;
+	}
+
+	LineTableRow const row = hwsim.drain_row();
+	if (!rows_equal(row, reference_rows.back())) {
+		mismatch_log << "\nmismatch on row " << std::dec << reference_rows.size() - 1 << " read through ROW_DELTA: address 0x" <<
+			std::hex << row.address << ", line 0x" << row.line << ", file 0x" << row.file << " (dut) != address 0x" <<
+			reference_rows.back().address << ", line 0x" << reference_rows.back().line << ", file 0x" <<
+			reference_rows.back().file << " (ref)\n";
+		return mismatch("ROW_DELTA row");
+	}
+	return true;
+}
+
+// Once the reference model has emitted its last row, the hardware must have no rows left: after
+// that row is popped it should run out of code and report READY with an empty row queue, or stay
+// ILLEGAL if the program ended on an illegal instruction.
+bool Testbench::compare_final_state() {
+	if (swsim.status == STATUS_EMIT_ROW) {
+		if (!hwsim.run_to_emit_row_or_illegal()) {
+			mismatch_log << "\nmismatch - hardware timeout after the last row\n";
+			return mismatch("hardware timeout after the last row");
+		}
+	}
+
+	uint32_t status_fields = hwsim.read_dword(STATUS);
+	uint32_t status        = status_fields & STATUS_CODE_MASK;
+	uint32_t queued_rows   = (status_fields >> STATUS_ROW_QUEUE_SHIFT) & STATUS_ROW_QUEUE_MASK;
+	uint32_t final_status  = swsim.status == STATUS_ILLEGAL ? STATUS_ILLEGAL : STATUS_READY;
+
+	if (status != final_status || queued_rows != 0) {
+		mismatch_log << "\nmismatch on final status: 0x" << std::hex << status << " with " << std::dec << queued_rows <<
+			" queued rows (dut) != 0x" << std::hex << final_status << " with 0 queued rows (ref)\n";
+		return mismatch("final status", status, final_status);
+	}
+
+	return true;
+}
+
+bool Testbench::compare_decoder(Test *test) {
+	LineDecoder decoder { test->program_header };
+
+	decoder_rows.clear();
+	bool const legal = decoder.decode(test->program.data(), test->program.size(), decoder_rows);
+
+	if (legal != (swsim.status != STATUS_ILLEGAL)) {
+		mismatch_log << "\nmismatch on legality: " << legal << " (decoder) != " << (swsim.status != STATUS_ILLEGAL) << " (ref)\n";
+		return mismatch("decoder legality");
+	}
+	if (decoder_rows.size() != reference_rows.size()) {
+		mismatch_log << "\nmismatch on row count: " << std::dec << decoder_rows.size() << " (decoder) != " << reference_rows.size() << " (ref)\n";
+		return mismatch("decoder row count");
+	}
+	for (size_t i = 0; i < decoder_rows.size(); ++i) {
+		if (!rows_equal(decoder_rows[i], reference_rows[i])) {
+			mismatch_log << "\nmismatch on decoder row " << std::dec << i << "\n";
+			return mismatch("decoder row");
+		}
 	}
 
 	return true;
 }
+
+// Run the test again with the hardware row filter set, and check that the rows it reports are the
+// reference model's rows filtered as FILTER_CTRL is documented to. The address window is placed
+// around one of the reference rows, so that the row held before the window is exercised.
+bool Testbench::compare_row_filter(Test *test) {
+	uint32_t const hash = hash_test(test);
+	uint32_t filter_lo  = reference_rows.empty() ? 0 : reference_rows[hash % reference_rows.size()].address;
+	filter_lo = (filter_lo + ((hash >> 16) & 0x3) - 1) & 0xfffffff;
+	uint32_t const filter_hi   = (filter_lo + ((hash >> 18) & 0x3F)) & 0xfffffff;
+	uint32_t const filter_ctrl = (hash >> 24) & 0x7;
+
+	filter_reference_rows(filter_lo, filter_hi, filter_ctrl);
+
+	hwsim.set_row_filter(filter_lo, filter_hi, filter_ctrl);
+	hwsim.set_program(test);
+	filtered_rows.clear();
+	bool timed_out = false;
+	uint32_t status;
+	while (true) {
+		if (!hwsim.run_to_emit_row_or_illegal()) {
+			timed_out = true;
+			break;
+		}
+		status = hwsim.read_dword(STATUS) & STATUS_CODE_MASK;
+		if (status != STATUS_EMIT_ROW) {
+			break;
+		}
+
+		filtered_rows.push_back(hwsim.drain_row());
+	}
+	hwsim.set_row_filter(0, 0, 0);
+
+	if (timed_out) {
+		mismatch_log << "\nmismatch - hardware timeout with row filter 0x" << std::hex << filter_ctrl << " [0x" <<
+			filter_lo << ", 0x" << filter_hi << ")\n";
+		return mismatch("hardware timeout with row filter");
+	}
+	uint32_t const final_status = swsim.status == STATUS_ILLEGAL ? STATUS_ILLEGAL : STATUS_READY;
+	if (status != final_status) {
+		mismatch_log << "\nmismatch on final status with row filter 0x" << std::hex << filter_ctrl << ": 0x" << status <<
+			" (dut) != 0x" << final_status << " (ref)\n";
+		return mismatch("final status with row filter", status, final_status);
+	}
+	if (filtered_rows.size() != filtered_reference_rows.size()) {
+		mismatch_log << "\nmismatch on row count with row filter 0x" << std::hex << filter_ctrl << " [0x" << filter_lo <<
+			", 0x" << filter_hi << "): " << std::dec << filtered_rows.size() << " (dut) != " <<
+			filtered_reference_rows.size() << " (ref)\n";
+		return mismatch("row count with row filter");
+	}
+	for (size_t i = 0; i < filtered_rows.size(); ++i) {
+		if (!rows_equal(filtered_rows[i], filtered_reference_rows[i])) {
+			mismatch_log << "\nmismatch on row " << std::dec << i << " with row filter 0x" << std::hex << filter_ctrl <<
+				" [0x" << filter_lo << ", 0x" << filter_hi << "): address 0x" << filtered_rows[i].address <<
+				" (dut), 0x" << filtered_reference_rows[i].address << " (ref)\n";
+			return mismatch("row with row filter");
+		}
+	}
+
+	return true;
+}
+
+// Filter the reference rows as the hardware should. The last row below the address window is held
+// back until a later row of the same sequence shows that it covers FILTER_LO, and is dropped if
+// that row is at FILTER_LO, or if the sequence ends first.
+void Testbench::filter_reference_rows(uint32_t filter_lo, uint32_t filter_hi, uint32_t filter_ctrl) {
+	bool const filter_address = filter_ctrl & FILTER_CTRL_ADDRESS;
+
+	filtered_reference_rows.clear();
+	LineTableRow held_row;
+	bool held = false;
+	for (LineTableRow const &row : reference_rows) {
+		bool const passes_flags = row.end_sequence || !(filter_ctrl & FILTER_CTRL_IS_STMT) || row.is_stmt;
+		if (!passes_flags) {
+			continue;
+		}
+
+		bool const below_window = filter_address && row.address < filter_lo;
+		bool const in_window    = !filter_address || (row.address >= filter_lo && row.address < filter_hi);
+		if (below_window && !row.end_sequence) {
+			held_row = row;
+			held     = true;
+			continue;
+		}
+		if (!below_window && held && row.address != filter_lo) {
+			filtered_reference_rows.push_back(held_row);
+		}
+		held = false;
+
+		if (in_window || ((filter_ctrl & FILTER_CTRL_END_SEQUENCE) && row.end_sequence)) {
+			filtered_reference_rows.push_back(row);
+		}
+	}
+}
@@ -1,17 +1,88 @@
 #pragma once
 
+#include <cstring>
+#include <iostream>
+
+#include "../tools/common/line_table.h"
+
 #include "sim.h"
 
 class Test;
 
+// How a test failed: the check it failed on, and for the checks on STATUS, the status codes the
+// hardware and the reference model reported. The minimizer only accepts a smaller test that fails
+// the same way, so that it doesn't wander off to a different bug.
+struct FailureSignature
+{
+	char const *check   = nullptr;
+	uint32_t dut_status = 0;
+	uint32_t ref_status = 0;
+
+	bool operator==(FailureSignature const &other) const {
+		return check && other.check && strcmp(check, other.check) == 0 && dut_status == other.dut_status &&
+			ref_status == other.ref_status;
+	}
+};
+
 class Testbench
 {
 	SoftwareSim swsim;
 	HardwareSim hwsim;
 
+	RowDrain row_drain = ROW_DRAIN_REGISTERS;
+
+	// Rows emitted by the reference model and the software decoder for the current test, kept
+	// between tests to avoid reallocating.
+	LineTable reference_rows;
+	LineTable decoder_rows;
+	LineTable filtered_reference_rows;
+	LineTable filtered_rows;
+
+	// Coverage points reached by the hardware during the current test.
+	Coverage test_coverage;
+
+	// Where mismatches are reported, which is std::cerr unless the testbench is quiet.
+	std::ostream mismatch_log;
+
+	// How the current test failed, if it did.
+	FailureSignature failure;
+
 public:
+	Testbench() : mismatch_log(std::cerr.rdbuf()) { }
+
 	bool run_test(Test *test);
 
+	void set_write_pacing(WritePacing write_pacing, uint32_t bus_latency) {
+		hwsim.set_write_pacing(write_pacing, bus_latency);
+	}
+
+	void set_row_drain(RowDrain row_drain_in) {
+		row_drain = row_drain_in;
+		hwsim.set_row_drain(row_drain_in);
+	}
+
+	void set_status_wait(StatusWait status_wait) {
+		hwsim.set_status_wait(status_wait);
+	}
+
+	void set_capture(uint32_t cycles) { hwsim.set_capture(cycles); }
+	bool write_capture(char const *file_name) const { return hwsim.write_capture(file_name); }
+
+	void set_coverage(bool enabled) { hwsim.set_coverage(enabled ? &test_coverage : nullptr); }
+	Coverage const &coverage() const { return test_coverage; }
+
+	void set_quiet(bool quiet) { mismatch_log.rdbuf(quiet ? nullptr : std::cerr.rdbuf()); }
+	FailureSignature const &failure_signature() const { return failure; }
+
+	uint64_t cycle_count() const { return hwsim.cycle_count(); }
+	uint64_t wasted_cycle_count() const { return hwsim.wasted_cycle_count(); }
+
 private:
+	bool mismatch(char const *check, uint32_t dut_status = 0, uint32_t ref_status = 0);
 	bool compare_state();
+	bool pop_row();
+	bool compare_final_state();
+	bool compare_decoder(Test *test);
+	bool compare_row_filter(Test *test);
+	void filter_reference_rows(uint32_t filter_lo, uint32_t filter_hi, uint32_t filter_ctrl);
 };
@@ -1,5 +1,16 @@
+#include <algorithm>
+
 #include "testgen.h"
 
+// The most instructions in a program, other than the end sequence at the end of every program.
+#define MAX_INSTRUCTIONS 1023
+
+static void add_end_sequence(Test *test) {
+	test->program.push_back(0);
+	test->program.push_back(1);
+	test->program.push_back(1);
+}
+
 ReplayTestGenerator::ReplayTestGenerator(char const *test_file_name) {
 	test = std::make_unique<Test>();
 	test->load(test_file_name);
@@ -16,14 +27,18 @@ std::unique_ptr<Test> ReplayTestGenerator::next_test() {
 }
 
 RandomTestGenerator::RandomTestGenerator(uint32_t num_tests) :
-	rng(dev()),
+	RandomTestGenerator(num_tests, std::random_device()()) {
+}
+
+RandomTestGenerator::RandomTestGenerator(uint32_t num_tests, uint32_t seed) :
+	rng(seed),
 	flag_dist(0, 1),
 	byte_dist(0, 255),
 	byte_dist_gt0(1, 255),
 	type_dist(0, 15),
 	opcode_base_high_dist(14, 255),
 	opcode_base_low_dist(0, 12),
-	num_instructions_dist(1, 1024),
+	num_instructions_dist(1, MAX_INSTRUCTIONS + 1),
 	leb_size_dist(1, 5),
 	leb_dist(0, 127),
 	illegal_ext_insn_dist(3, 255),
@@ -47,9 +62,24 @@ std::unique_ptr<Test> RandomTestGenerator::generate_test() {
 
 	bool can_have_illegal = flag_dist(rng) == 1;
 
-	test->program_header |= flag_dist(rng);             // default_is_stmt
-	test->program_header |= (byte_dist(rng) << 8);      // line_base
-	test->program_header |= (byte_dist_gt0(rng) << 16); // line_range
+	test->program_header = random_program_header();
+	uint32_t opcode_base = test->program_header >> 24;
+
+	uint32_t num_instructions = num_instructions_dist(rng);
+	for (uint32_t i = 0; i < num_instructions - 1; ++i) {
+		add_random_instruction(test.get(), opcode_base, can_have_illegal);
+	}
+	add_end_sequence(test.get());
+
+	return test;
+}
+
+uint32_t RandomTestGenerator::random_program_header() {
+	uint32_t program_header = 0;
+
+	program_header |= flag_dist(rng);             // default_is_stmt
+	program_header |= (byte_dist(rng) << 8);      // line_base
+	program_header |= (byte_dist_gt0(rng) << 16); // line_range
 	auto opcode_base_type = type_dist(rng);
 	uint32_t opcode_base;
 	if (opcode_base_type == 0) {
@@ -59,17 +89,9 @@ std::unique_ptr<Test> RandomTestGenerator::generate_test() {
 	} else {
 		opcode_base = 0x0D;
 	}
-	test->program_header |= (opcode_base << 24);
-
-	uint32_t num_instructions = num_instructions_dist(rng);
-	for (uint32_t i = 0; i < num_instructions - 1; ++i) {
-		add_random_instruction(test.get(), opcode_base, can_have_illegal);
-	}
-	test->program.push_back(0);
-	test->program.push_back(1);
-	test->program.push_back(1);
+	program_header |= (opcode_base << 24);
 
-	return test;
+	return program_header;
 }
 
 void RandomTestGenerator::add_random_instruction(Test *test, uint32_t opcode_base, bool can_have_illegal) {
@@ -145,3 +167,140 @@ void RandomTestGenerator::add_random_instruction(Test *test, uint32_t opcode_bas
 		}
 	}
 }
+
+CoverageTestGenerator::CoverageTestGenerator(uint32_t num_tests) :
+	RandomTestGenerator(num_tests),
+	fresh_dist(0, 7),
+	mutation_dist(0, 5),
+	mutation_count_dist(1, 4),
+	run_length_dist(1, 8) {
+}
+
+// Most tests are mutations of a program from the corpus. One in eight is a fresh random program,
+// as is every test until the first program reaches new coverage.
+std::unique_ptr<Test> CoverageTestGenerator::next_test() {
+	tests_remaining -= 1;
+
+	CorpusEntry entry;
+	if (corpus.empty() || fresh_dist(rng) == 0) {
+		entry = random_entry();
+	} else {
+		entry = mutate_entry(corpus[random_index(corpus.size())]);
+	}
+
+	std::unique_ptr<Test> test = entry_test(entry);
+	pending.emplace(test.get(), std::move(entry));
+	return test;
+}
+
+void CoverageTestGenerator::report_coverage(Test const *test, bool new_coverage) {
+	auto it = pending.find(test);
+	if (it == pending.end()) {
+		return;
+	}
+	if (new_coverage) {
+		corpus.push_back(std::move(it->second));
+	}
+	pending.erase(it);
+}
+
+CorpusEntry CoverageTestGenerator::random_entry() {
+	CorpusEntry entry;
+	entry.can_have_illegal = flag_dist(rng) == 1;
+	entry.program_header   = random_program_header();
+
+	uint32_t num_instructions = num_instructions_dist(rng);
+	for (uint32_t i = 0; i < num_instructions - 1; ++i) {
+		std::vector<uint8_t> instruction = random_instruction(entry);
+		if (!instruction.empty()) {
+			entry.instructions.push_back(std::move(instruction));
+		}
+	}
+
+	return entry;
+}
+
+CorpusEntry CoverageTestGenerator::mutate_entry(CorpusEntry const &entry) {
+	CorpusEntry mutated = entry;
+	uint32_t num_mutations = mutation_count_dist(rng);
+	for (uint32_t i = 0; i < num_mutations; ++i) {
+		mutate_once(mutated);
+	}
+	if (mutated.instructions.size() > MAX_INSTRUCTIONS) {
+		mutated.instructions.resize(MAX_INSTRUCTIONS);
+	}
+	return mutated;
+}
+
+// Apply a single mutation. Whole instructions are inserted, removed, repeated, replaced or spliced
+// in from another program in the corpus, or the program header is replaced, so that the mutated
+// program is as well formed as a random one.
+void CoverageTestGenerator::mutate_once(CorpusEntry &entry) {
+	std::vector<std::vector<uint8_t>> &instructions = entry.instructions;
+	size_t const size = instructions.size();
+
+	switch (mutation_dist(rng)) {
+		case 0: {
+			size_t const position = random_index(size + 1);
+			uint32_t const run_length = run_length_dist(rng);
+			for (uint32_t i = 0; i < run_length; ++i) {
+				instructions.insert(instructions.begin() + position, random_instruction(entry));
+			}
+		} break;
+		case 1: {
+			if (size == 0) {
+				break;
+			}
+			size_t const position = random_index(size);
+			size_t const run_length = std::min<size_t>(run_length_dist(rng), size - position);
+			instructions.erase(instructions.begin() + position, instructions.begin() + position + run_length);
+		} break;
+		case 2: {
+			// Repeating an instruction, such as a special opcode, makes it more likely that a write
+			// lands while the previous one is still executing.
+			if (size == 0) {
+				break;
+			}
+			size_t const position = random_index(size);
+			std::vector<uint8_t> const instruction = instructions[position];
+			instructions.insert(instructions.begin() + position, run_length_dist(rng), instruction);
+		} break;
+		case 3: {
+			if (size == 0) {
+				break;
+			}
+			instructions[random_index(size)] = random_instruction(entry);
+		} break;
+		case 4: {
+			CorpusEntry const &other = corpus[random_index(corpus.size())];
+			size_t const position = random_index(size + 1);
+			size_t const other_position = random_index(other.instructions.size() + 1);
+			instructions.resize(position);
+			instructions.insert(instructions.end(), other.instructions.begin() + other_position,
+				other.instructions.end());
+		} break;
+		default: {
+			entry.program_header = random_program_header();
+		} break;
+	}
+}
+
+std::vector<uint8_t> CoverageTestGenerator::random_instruction(CorpusEntry const &entry) {
+	Test test;
+	add_random_instruction(&test, entry.program_header >> 24, entry.can_have_illegal);
+	return std::move(test.program);
+}
+
+size_t CoverageTestGenerator::random_index(size_t size) {
+	return std::uniform_int_distribution<size_t>(0, size - 1)(rng);
+}
+
+std::unique_ptr<Test> CoverageTestGenerator::entry_test(CorpusEntry const &entry) {
+	auto test = std::make_unique<Test>();
+	test->program_header = entry.program_header;
+	for (std::vector<uint8_t> const &instruction : entry.instructions) {
+		test->program.insert(test->program.end(), instruction.begin(), instruction.end());
+	}
+	add_end_sequence(test.get());
+	return test;
+}
@@ -3,6 +3,8 @@
 #include <cstdint>
 #include <random>
 #include <memory>
+#include <unordered_map>
+#include <vector>
 
 #include "test.h"
 
@@ -11,6 +13,10 @@ class TestGenerator
 public:
 	virtual bool has_tests() = 0;
 	virtual std::unique_ptr<Test> next_test() = 0;
+
+	// Called after each test has run, with whether it reached any coverage points that no earlier
+	// test had.
+	virtual void report_coverage(Test const *, bool) { }
 };
 
 class ReplayTestGenerator : public TestGenerator
@@ -26,7 +32,7 @@ public:
 
 class RandomTestGenerator : public TestGenerator
 {
-	std::random_device dev;
+protected:
 	std::mt19937 rng;
 	std::uniform_int_distribution<std::mt19937::result_type> flag_dist;
 	std::uniform_int_distribution<std::mt19937::result_type> byte_dist;
@@ -46,11 +52,53 @@ class RandomTestGenerator : public TestGenerator
 
 public:
 	RandomTestGenerator(uint32_t num_tests);
+	RandomTestGenerator(uint32_t num_tests, uint32_t seed);
 
 	bool has_tests() override;
 	std::unique_ptr<Test> next_test() override;
 
+protected:
+	uint32_t random_program_header();
+	void add_random_instruction(Test *test, uint32_t opcode_base, bool can_have_illegal);
+
 private:
 	std::unique_ptr<Test> generate_test();
-	void add_random_instruction(Test *test, uint32_t opcode_base, bool can_have_illegal);
+};
+
+// A program kept by the coverage guided generator, split into the instructions it was generated
+// from, so that it can be mutated without splitting an instruction from its operands.
+struct CorpusEntry
+{
+	uint32_t program_header;
+	bool can_have_illegal;
+	std::vector<std::vector<uint8_t>> instructions;
+};
+
+// Generates tests by mutating the programs that have reached new coverage points so far, with
+// occasional fresh random programs to find new starting points.
+class CoverageTestGenerator : public RandomTestGenerator
+{
+	std::uniform_int_distribution<std::mt19937::result_type> fresh_dist;
+	std::uniform_int_distribution<std::mt19937::result_type> mutation_dist;
+	std::uniform_int_distribution<std::mt19937::result_type> mutation_count_dist;
+	std::uniform_int_distribution<std::mt19937::result_type> run_length_dist;
+
+	std::vector<CorpusEntry> corpus;
+
+	// The programs of the tests handed out but not yet reported, keyed by test.
+	std::unordered_map<Test const*, CorpusEntry> pending;
+
+public:
+	CoverageTestGenerator(uint32_t num_tests);
+
+	std::unique_ptr<Test> next_test() override;
+	void report_coverage(Test const *test, bool new_coverage) override;
+
+private:
+	CorpusEntry random_entry();
+	CorpusEntry mutate_entry(CorpusEntry const &entry);
+	void mutate_once(CorpusEntry &entry);
+	std::vector<uint8_t> random_instruction(CorpusEntry const &entry);
+	size_t random_index(size_t size);
+	std::unique_ptr<Test> entry_test(CorpusEntry const &entry);
 };
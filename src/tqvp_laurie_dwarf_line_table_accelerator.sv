@@ -20,7 +20,10 @@ module tqvp_laurie_dwarf_line_table_accelerator(
     input  [1:0]  data_write_n,
     input  [1:0]  data_read_n,
     output [31:0] data_out,
-    output        data_ready
+    output        data_ready,
+
+    // Interrupt to TinyQV core.
+    output        user_interrupt
 );
 
     // REGISTER READ/WRITE CONTROL VALUES
@@ -43,6 +46,13 @@ module tqvp_laurie_dwarf_line_table_accelerator(
     localparam AM_LINE_COL_FLAGS = 4'h4;
     localparam STATUS            = 4'h5;
     localparam INFO              = 4'h6;
+    localparam CODE_FIFO         = 4'h7;
+    localparam ROW_POP           = 4'h8;
+    localparam FILTER_LO         = 4'h9;
+    localparam FILTER_HI         = 4'hA;
+    localparam FILTER_CTRL       = 4'hB;
+    localparam ROW_DELTA         = 4'hC;
+    localparam INT_MASK          = 4'hD;
 
     // PERIPHERAL STATUS CODES
     // Public interface, values read by software from the STATUS register. Defined by the spec for
@@ -85,7 +95,12 @@ module tqvp_laurie_dwarf_line_table_accelerator(
     enum logic[4:0] {
         STATE_READY,
         STATE_EXTENDED_OPCODE,
-        STATE_SPECIAL_OPCODE,
+        STATE_SPECIAL_OPCODE_DIVIDE0,
+        STATE_SPECIAL_OPCODE_DIVIDE1,
+        STATE_SPECIAL_OPCODE_DIVIDE2,
+        STATE_SPECIAL_OPCODE_DIVIDE3,
+        STATE_SPECIAL_OPCODE_ADVANCE_ADDRESS,
+        STATE_SPECIAL_OPCODE_ADVANCE_LINE,
         STATE_PAUSE_FOR_EMIT_ROW,
         STATE_PAUSE_FOR_END_SEQUENCE,
         STATE_PAUSE_FOR_ILLEGAL,
@@ -106,7 +121,14 @@ module tqvp_laurie_dwarf_line_table_accelerator(
     always_ff @(posedge clk) begin
         if      (set_st_state_ready)                  st_state <= STATE_READY;
         else if (set_st_state_extended_opcode)        st_state <= STATE_EXTENDED_OPCODE;
-        else if (set_st_state_special_opcode)         st_state <= STATE_SPECIAL_OPCODE;
+        else if (set_st_state_special_opcode_divide0) st_state <= STATE_SPECIAL_OPCODE_DIVIDE0;
+        else if (set_st_state_special_opcode_divide1) st_state <= STATE_SPECIAL_OPCODE_DIVIDE1;
+        else if (set_st_state_special_opcode_divide2) st_state <= STATE_SPECIAL_OPCODE_DIVIDE2;
+        else if (set_st_state_special_opcode_divide3) st_state <= STATE_SPECIAL_OPCODE_DIVIDE3;
+        else if (set_st_state_special_opcode_advance_address)
+            st_state <= STATE_SPECIAL_OPCODE_ADVANCE_ADDRESS;
+        else if (set_st_state_special_opcode_advance_line)
+            st_state <= STATE_SPECIAL_OPCODE_ADVANCE_LINE;
         else if (set_st_state_pause_for_emit_row)     st_state <= STATE_PAUSE_FOR_EMIT_ROW;
         else if (set_st_state_pause_for_end_sequence) st_state <= STATE_PAUSE_FOR_END_SEQUENCE;
         else if (set_st_state_pause_for_illegal)      st_state <= STATE_PAUSE_FOR_ILLEGAL;
@@ -126,9 +148,12 @@ module tqvp_laurie_dwarf_line_table_accelerator(
 
     logic reset_this_cycle;
     logic write_this_cycle;
+    logic write_pauses_execution_this_cycle;
     logic exec_current_instruction_this_cycle;
     logic special_opcode_this_cycle;
-    logic special_opcode_end_this_cycle;
+    logic divide_this_cycle;
+    logic advance_address_by_quotient_this_cycle;
+    logic advance_line_by_remainder_this_cycle;
     logic parse_byte_this_cycle;
     logic parse_extended_opcode_this_cycle;
     logic parse_standard_opcode_this_cycle;
@@ -137,20 +162,41 @@ module tqvp_laurie_dwarf_line_table_accelerator(
     logic parse_special_opcode_or_constaddpc_this_cycle;
     logic execution_paused;
     logic write_status;
+    logic read_row_delta_this_cycle;
+    logic ack_row_delta_this_cycle;
+    logic pop_row;
+    logic row_retirable_this_cycle;
+    logic commit_held_row_this_cycle;
+    logic retire_row_this_cycle;
+    logic push_row_this_cycle;
+    logic hold_row_this_cycle;
+    logic retire_end_sequence_this_cycle;
+    logic clear_illegal_this_cycle;
 
     assign reset_this_cycle = !deferred_rst_n;
 
     assign write_this_cycle = deferred_rst_n && data_write_active && data_write_valid_alignment;
 
-    assign exec_current_instruction_this_cycle = deferred_rst_n && !write_this_cycle && state_is_exec;
+    // Writes to PROGRAM_CODE only push to the program code FIFO, so execution can continue while
+    // the host streams in more code. Every other write pauses execution for that cycle.
+    assign write_pauses_execution_this_cycle = write_this_cycle && !address_is_program_code;
+
+    assign exec_current_instruction_this_cycle =
+        deferred_rst_n && !write_pauses_execution_this_cycle && state_is_exec;
+
+    assign special_opcode_this_cycle =
+        deferred_rst_n && !write_pauses_execution_this_cycle && state_is_special_opcode;
+
+    assign divide_this_cycle = special_opcode_this_cycle && state_is_special_opcode_divide;
 
-    assign special_opcode_this_cycle = deferred_rst_n && !write_this_cycle && state_is_special_opcode;
+    assign advance_address_by_quotient_this_cycle =
+        special_opcode_this_cycle && state_is_special_opcode_advance_address;
 
-    assign special_opcode_end_this_cycle =
-        special_opcode_this_cycle && st_operand[7:0] < ph_line_range;
+    assign advance_line_by_remainder_this_cycle =
+        special_opcode_this_cycle && state_is_special_opcode_advance_line;
 
     assign parse_byte_this_cycle =
-        deferred_rst_n && !write_this_cycle && !exec_current_instruction_this_cycle &&
+        deferred_rst_n && !write_pauses_execution_this_cycle && !exec_current_instruction_this_cycle &&
         !special_opcode_this_cycle && !execution_paused && current_byte_valid;
 
     assign parse_extended_opcode_this_cycle = parse_byte_this_cycle && state_is_extended_opcode;
@@ -173,9 +219,52 @@ module tqvp_laurie_dwarf_line_table_accelerator(
 
     assign write_status = write_this_cycle && address_is_status;
 
+    // Reads have no side effects, other than a 32 bit read of ROW_DELTA, which acknowledges the row
+    // at the head of the row queue if it could be packed into ROW_DELTA.
+    assign read_row_delta_this_cycle =
+        deferred_rst_n && data_read_32_bit && address_4_byte_aligned && address_is_row_delta;
+
+    assign ack_row_delta_this_cycle = read_row_delta_this_cycle && !row_delta_escape;
+
+    // Writing ROW_POP or STATUS, or reading ROW_DELTA, while there are rows in the row queue, pops
+    // the row at the head of the queue. Writing STATUS with an empty row queue
+    // after an illegal instruction clears the illegal state.
+    assign pop_row =
+        (write_status || write_row_pop || ack_row_delta_this_cycle) && !row_queue_empty;
+
+    // Rows are emitted by pausing execution for a cycle, so that the abstract machine state is
+    // final before it is pushed on to the row queue. If the row queue is full, execution remains
+    // paused until a row is popped. Retiring a row only pushes it on to the row queue if it passes
+    // the row filter, otherwise it is either dropped or held as the row before the filter window.
+    // If this row shows that the held row covers the start of the window, the held row is
+    // committed to the row queue first, and this row is retired the cycle after.
+    assign row_retirable_this_cycle =
+        deferred_rst_n && !write_pauses_execution_this_cycle && !row_queue_full &&
+        (state_is_pause_for_emit_row || state_is_pause_for_end_sequence);
+
+    assign commit_held_row_this_cycle =
+        row_retirable_this_cycle && st_held_row_valid && row_closes_held_row &&
+        !am_address_at_filter_lo;
+
+    assign retire_row_this_cycle = row_retirable_this_cycle && !commit_held_row_this_cycle;
+
+    assign push_row_this_cycle = retire_row_this_cycle && row_reported;
+
+    assign hold_row_this_cycle = retire_row_this_cycle && row_held;
+
+    assign retire_end_sequence_this_cycle =
+        retire_row_this_cycle && state_is_pause_for_end_sequence;
+
+    assign clear_illegal_this_cycle = write_status && row_queue_empty && state_is_pause_for_illegal;
+
     logic set_st_state_ready;
     logic set_st_state_extended_opcode;
-    logic set_st_state_special_opcode;
+    logic set_st_state_special_opcode_divide0;
+    logic set_st_state_special_opcode_divide1;
+    logic set_st_state_special_opcode_divide2;
+    logic set_st_state_special_opcode_divide3;
+    logic set_st_state_special_opcode_advance_address;
+    logic set_st_state_special_opcode_advance_line;
     logic set_st_state_pause_for_emit_row;
     logic set_st_state_pause_for_end_sequence;
     logic set_st_state_pause_for_illegal;
@@ -193,20 +282,38 @@ module tqvp_laurie_dwarf_line_table_accelerator(
     logic set_st_state_exec;
 
     assign set_st_state_ready =
-        reset_this_cycle || write_program_header || write_status ||
-        (special_opcode_end_this_cycle && current_instruction_is_constaddpc) ||
+        reset_this_cycle || write_program_header || retire_row_this_cycle ||
+        clear_illegal_this_cycle ||
+        (advance_address_by_quotient_this_cycle && current_instruction_is_constaddpc) ||
         (exec_current_instruction_this_cycle && !current_instruction_is_extended);
 
     assign set_st_state_extended_opcode =
         exec_current_instruction_this_cycle && current_instruction_is_extended;
 
-    assign set_st_state_special_opcode =
-        parse_special_opcode_or_constaddpc_this_cycle ||
-        (state_is_special_opcode && !special_opcode_end_this_cycle);
+    assign set_st_state_special_opcode_divide0 =
+        parse_special_opcode_or_constaddpc_this_cycle && ph_divider_skipped_steps == 2'h0;
+
+    assign set_st_state_special_opcode_divide1 =
+        (parse_special_opcode_or_constaddpc_this_cycle && ph_divider_skipped_steps == 2'h1) ||
+        (divide_this_cycle && state_is_special_opcode_divide0);
+
+    assign set_st_state_special_opcode_divide2 =
+        (parse_special_opcode_or_constaddpc_this_cycle && ph_divider_skipped_steps == 2'h2) ||
+        (divide_this_cycle && state_is_special_opcode_divide1);
+
+    assign set_st_state_special_opcode_divide3 =
+        (parse_special_opcode_or_constaddpc_this_cycle && ph_divider_skipped_steps == 2'h3) ||
+        (divide_this_cycle && state_is_special_opcode_divide2);
+
+    assign set_st_state_special_opcode_advance_address =
+        divide_this_cycle && state_is_special_opcode_divide3;
+
+    assign set_st_state_special_opcode_advance_line =
+        advance_address_by_quotient_this_cycle && current_instruction_is_nop;
 
     assign set_st_state_pause_for_emit_row =
         (parse_standard_or_special_opcode_this_cycle && current_byte_is_lns_copy) ||
-        (special_opcode_end_this_cycle && current_instruction_is_nop);
+        advance_line_by_remainder_this_cycle;
 
     assign set_st_state_pause_for_end_sequence =
         parse_extended_opcode_this_cycle && current_byte_is_lne_endsequence;
@@ -230,39 +337,51 @@ module tqvp_laurie_dwarf_line_table_accelerator(
             current_byte_is_lns_setisa || current_byte_is_extended_opcode_start));
 
     assign set_st_state_parse_leb_128_byte1 =
-        parse_byte_this_cycle && state_is_parse_leb_128_byte0 && !leb_last_byte;
+        parse_leb_128_continue_this_cycle && operand_next_position == 4'h1;
 
     assign set_st_state_parse_leb_128_byte2 =
-        parse_byte_this_cycle && state_is_parse_leb_128_byte1 && !leb_last_byte;
+        parse_leb_128_continue_this_cycle && operand_next_position == 4'h2;
 
     assign set_st_state_parse_leb_128_byte3 =
-        parse_byte_this_cycle && !leb_last_byte && state_is_parse_leb_128_byte2;
+        parse_leb_128_continue_this_cycle && operand_next_position == 4'h3;
 
     assign set_st_state_parse_leb_128_overflow =
-        parse_byte_this_cycle && !leb_last_byte &&
-        (state_is_parse_leb_128_byte3 || state_is_parse_leb_128_overflow);
+        parse_leb_128_continue_this_cycle && operand_next_position >= 4'h4;
 
     assign set_st_state_parse_u16_byte0 =
         parse_standard_opcode_this_cycle && current_byte_is_lne_fixedadvancepc;
 
-    assign set_st_state_parse_u16_byte1 = parse_byte_this_cycle && state_is_parse_u16_byte0;
+    assign set_st_state_parse_u16_byte1 = parse_u16_continue_this_cycle;
 
     assign set_st_state_parse_u32_byte0 =
         parse_extended_opcode_this_cycle && current_byte_is_lne_setaddress;
 
-    assign set_st_state_parse_u32_byte1 = parse_byte_this_cycle && state_is_parse_u32_byte0;
+    assign set_st_state_parse_u32_byte1 =
+        parse_u32_continue_this_cycle && operand_next_position == 4'h1;
+
+    assign set_st_state_parse_u32_byte2 =
+        parse_u32_continue_this_cycle && operand_next_position == 4'h2;
+
+    assign set_st_state_parse_u32_byte3 =
+        parse_u32_continue_this_cycle && operand_next_position == 4'h3;
+
+    assign set_st_state_exec = parse_operand_this_cycle && operand_end;
+
+    logic parse_operand_this_cycle;
+    logic parse_leb_128_continue_this_cycle;
+    logic parse_u16_continue_this_cycle;
+    logic parse_u32_continue_this_cycle;
 
-    assign set_st_state_parse_u32_byte2 = parse_byte_this_cycle && state_is_parse_u32_byte1;
+    assign parse_operand_this_cycle = parse_byte_this_cycle && state_is_parse_operand;
 
-    assign set_st_state_parse_u32_byte3 = parse_byte_this_cycle && state_is_parse_u32_byte2;
+    assign parse_leb_128_continue_this_cycle =
+        parse_operand_this_cycle && !operand_end && state_is_parse_leb_128;
 
-    assign set_st_state_exec =
-        parse_byte_this_cycle && (
-            (leb_last_byte && (
-                state_is_parse_leb_128_byte0 || state_is_parse_leb_128_byte1 ||
-                state_is_parse_leb_128_byte2 || state_is_parse_leb_128_byte3 ||
-                state_is_parse_leb_128_overflow)
-            ) || state_is_parse_u16_byte1 || state_is_parse_u32_byte3);
+    assign parse_u16_continue_this_cycle =
+        parse_operand_this_cycle && !operand_end && state_is_parse_u16;
+
+    assign parse_u32_continue_this_cycle =
+        parse_operand_this_cycle && !operand_end && state_is_parse_u32;
 
     // CURRENT INSTRUCTION
     // Instructions with operands and extended instructions cannot be executed on their first byte,
@@ -313,7 +432,8 @@ module tqvp_laurie_dwarf_line_table_accelerator(
     logic set_current_instruction_setdiscriminator;
 
     assign set_current_instruction_nop =
-        reset_this_cycle || write_program_header || write_status ||
+        reset_this_cycle || write_program_header || retire_row_this_cycle ||
+        clear_illegal_this_cycle ||
         (parse_standard_opcode_this_cycle && current_byte_is_lns_setisa) ||
         parse_special_opcode_this_cycle;
 
@@ -352,7 +472,8 @@ module tqvp_laurie_dwarf_line_table_accelerator(
     logic set_leb_signed;
 
     assign unset_leb_signed =
-        reset_this_cycle || write_program_header || write_status ||
+        reset_this_cycle || write_program_header || retire_row_this_cycle ||
+        clear_illegal_this_cycle ||
         (parse_standard_opcode_this_cycle && (
             current_byte_is_lns_advancepc || current_byte_is_lns_setfile ||
             current_byte_is_lns_setcolumn || current_byte_is_lns_setisa ||
@@ -368,22 +489,27 @@ module tqvp_laurie_dwarf_line_table_accelerator(
     end
 
     // INSTRUCTION POINTER
-    // Pointer to the byte index in the code buffer of the next byte to process. Although there are
-    // only four bytes in the buffer, this must be able to represent one off the end to indicate
-    // that all the bytes have been processed, which is why this must be three bits rather than
-    // just two.
+    // Pointer to the byte index in the entry at the head of the program code FIFO of the next byte
+    // to process. When the last valid byte of the entry is processed the entry is popped, and the
+    // pointer returns to the first byte of the next entry, so it never points off the end. Opcodes
+    // advance the pointer by one byte, and operands by the number of operand bytes parsed.
 
-    logic [2:0] st_ip;
+    logic [1:0] st_ip;
 
     always_ff @(posedge clk) begin
-        if      (reset_st_ip)           st_ip <= 3'h0;
-        else if (parse_byte_this_cycle) st_ip <= incrementer_dest[2:0];
+        if      (reset_st_ip)           st_ip <= 2'h0;
+        else if (parse_byte_this_cycle) st_ip <= next_st_ip;
     end
 
-    logic reset_st_ip;
+    logic       reset_st_ip;
+    logic [2:0] parse_length;
+    logic [1:0] next_st_ip;
+
+    assign reset_st_ip = reset_st_program_code || pop_program_code;
 
-    assign reset_st_ip = reset_this_cycle || write_program_header || write_program_code ||
-        (write_status && state_is_pause_for_illegal);
+    assign parse_length = parse_operand_this_cycle ? operand_length : 3'h1;
+
+    assign next_st_ip = st_ip + parse_length[1:0];
 
     // PROGRAM HEADER
     // Some parts of the DWARF line table program header have an impact on execution. These parts
@@ -410,6 +536,25 @@ module tqvp_laurie_dwarf_line_table_accelerator(
         else if (write_program_header) ph_line_range <= next_ph_line_range;
     end
 
+    // Three times the line range, used by the special opcode divider. It is calculated when the
+    // program header is written so that the divider does not need a multiplier of its own.
+    logic [9:0] ph_line_range_x3;
+
+    always_ff @(posedge clk) begin
+        if      (reset_ph_line_range)  ph_line_range_x3 <= 10'h3;
+        else if (write_program_header) ph_line_range_x3 <= next_ph_line_range_x3;
+    end
+
+    // The number of leading divider steps that can be skipped for this line range, also calculated
+    // when the program header is written. A step can be skipped when its partial remainder cannot
+    // reach line_range whatever the adjusted opcode, since it would always produce a zero quotient.
+    logic [1:0] ph_divider_skipped_steps;
+
+    always_ff @(posedge clk) begin
+        if      (reset_ph_line_range)  ph_divider_skipped_steps <= 2'h0;
+        else if (write_program_header) ph_divider_skipped_steps <= next_ph_divider_skipped_steps;
+    end
+
     logic [7:0] ph_opcode_base;
 
     always_ff @(posedge clk) begin
@@ -423,6 +568,8 @@ module tqvp_laurie_dwarf_line_table_accelerator(
     logic       next_ph_default_is_stmt;
     logic [7:0] next_ph_line_base;
     logic [7:0] next_ph_line_range;
+    logic [9:0] next_ph_line_range_x3;
+    logic [1:0] next_ph_divider_skipped_steps;
     logic [7:0] next_ph_opcode_base;
 
     assign write_program_header = write_this_cycle && address_is_program_header;
@@ -443,6 +590,15 @@ module tqvp_laurie_dwarf_line_table_accelerator(
         data_write_32_bit      ? data_in[23:16] :
                                  ph_line_range;
 
+    assign next_ph_line_range_x3 =
+        { 1'h0, next_ph_line_range, 1'h0 } + { 2'h0, next_ph_line_range };
+
+    assign next_ph_divider_skipped_steps =
+        next_ph_line_range >= 8'd64 ? 2'h3 :
+        next_ph_line_range >= 8'd16 ? 2'h2 :
+        next_ph_line_range >= 8'd4  ? 2'h1 :
+                                      2'h0;
+
     assign next_ph_opcode_base =
         write_byte3_from_byte0 ? data_in[7:0] :
         write_byte3_from_byte1 ? data_in[15:8] :
@@ -450,93 +606,148 @@ module tqvp_laurie_dwarf_line_table_accelerator(
                                  ph_opcode_base;
 
     // PROGRAM CODE
-    // Program code can be written by the host CPU in groups of 1, 2 or 4 bytes. These are stored in
-    // the program code buffer, and which bytes have been written are recorded in the program code
-    // buffer valid, in the same format as the read and write flags from the interface. Each write
-    // completely overwrites the buffer. Generally the accelerator can parse one byte per cycle.
-    // Since writes can occur no more often than once every 8 cycles, it is generally fine since
-    // the whole buffer should already have been processed. In cases where this is not the case,
-    // such as long-running special instructions, the host must be interrupted so that it knows to
-    // stall until the accelerator is ready. If the host ignores this, the program code will be
-    // corrupted.
-
-    logic [1:0]  st_program_code_valid;
+    // Program code can be written by the host CPU in groups of 1, 2 or 4 bytes. Each write is
+    // pushed on to the tail of a small FIFO, along with which bytes were written, recorded in the
+    // same format as the read and write flags from the interface. The accelerator parses the entry
+    // at the head of the FIFO through the program code window below, taking opcodes a byte per
+    // cycle but operands a whole window per cycle, and pops it once its last valid byte has been
+    // processed. This allows the host to write several chunks of code in a burst without polling
+    // STATUS between them, and to keep writing code while the accelerator is busy. The number of
+    // free entries can be read from the CODE_FIFO register. Writes to a full FIFO are discarded,
+    // so the host must not write more chunks than there are free entries.
+
+    localparam [2:0] PROGRAM_CODE_FIFO_DEPTH = 3'h4;
+
+    logic [31:0] st_program_code_buffer [PROGRAM_CODE_FIFO_DEPTH];
+    logic [1:0]  st_program_code_valid  [PROGRAM_CODE_FIFO_DEPTH];
 
     always_ff @(posedge clk) begin
-        if      (reset_st_program_code) st_program_code_valid <= RW_NONE;
-        else if (write_program_code)    st_program_code_valid <= data_write_n;
+        if (push_program_code) begin
+            st_program_code_buffer[st_program_code_tail] <= next_program_code_buffer;
+            st_program_code_valid[st_program_code_tail]  <= data_write_n;
+        end
     end
 
-    logic [31:0] st_program_code_buffer;
+    logic [1:0] st_program_code_head;
 
     always_ff @(posedge clk) begin
-        if      (reset_st_program_code)         st_program_code_buffer <= 32'h0;
-        else if (write_program_code_one_byte)   st_program_code_buffer <= { 24'h0, data_in[7:0] };
-        else if (write_program_code_two_bytes)  st_program_code_buffer <= { 16'h0, data_in[15:0] };
-        else if (write_program_code_four_bytes) st_program_code_buffer <= data_in;
+        if      (reset_st_program_code) st_program_code_head <= 2'h0;
+        else if (pop_program_code)      st_program_code_head <= st_program_code_head + 2'h1;
     end
 
-    logic reset_st_program_code;
-    logic write_program_code;
-    logic write_program_code_one_byte;
-    logic write_program_code_two_bytes;
-    logic write_program_code_four_bytes;
+    logic [1:0] st_program_code_tail;
+
+    always_ff @(posedge clk) begin
+        if      (reset_st_program_code) st_program_code_tail <= 2'h0;
+        else if (push_program_code)     st_program_code_tail <= st_program_code_tail + 2'h1;
+    end
+
+    logic [2:0] st_program_code_level;
+
+    always_ff @(posedge clk) begin
+        if      (reset_st_program_code)        st_program_code_level <= 3'h0;
+        else if (increment_program_code_level) st_program_code_level <= st_program_code_level + 3'h1;
+        else if (decrement_program_code_level) st_program_code_level <= st_program_code_level - 3'h1;
+    end
 
-    assign reset_st_program_code = reset_this_cycle || write_program_header ||
-        (write_status && state_is_pause_for_illegal);
+    logic        reset_st_program_code;
+    logic        write_program_code;
+    logic        push_program_code;
+    logic        pop_program_code;
+    logic        increment_program_code_level;
+    logic        decrement_program_code_level;
+    logic [31:0] next_program_code_buffer;
+    logic [31:0] program_code_head_buffer;
+    logic [1:0]  program_code_head_valid;
+    logic [2:0]  program_code_free;
+
+    assign reset_st_program_code =
+        reset_this_cycle || write_program_header || clear_illegal_this_cycle;
 
     assign write_program_code = write_this_cycle && address_is_program_code;
 
-    assign write_program_code_one_byte = write_program_code && data_write_8_bit;
+    assign push_program_code = write_program_code && !program_code_fifo_full;
 
-    assign write_program_code_two_bytes = write_program_code && data_write_16_bit;
+    assign pop_program_code = parse_byte_this_cycle && parse_length == program_code_window_size;
 
-    assign write_program_code_four_bytes = write_program_code && data_write_32_bit;
+    assign increment_program_code_level = push_program_code && !pop_program_code;
 
-    // CURRENT BYTE
-    // The accelerator processes one byte per cycle. The current byte is the value of the byte
-    // pointed to by the instruction pointer in the program buffer, or 0 if the instruction pointer
-    // is off the end of the buffer. This does not consider whether or not the byte is actually
-    // valid.
+    assign decrement_program_code_level = pop_program_code && !push_program_code;
 
-    logic [7:0] current_byte;
+    assign next_program_code_buffer =
+        data_write_8_bit  ? { 24'h0, data_in[7:0] } :
+        data_write_16_bit ? { 16'h0, data_in[15:0] } :
+                            data_in;
+
+    assign program_code_head_buffer = st_program_code_buffer[st_program_code_head];
+
+    assign program_code_head_valid =
+        program_code_fifo_empty ? RW_NONE : st_program_code_valid[st_program_code_head];
+
+    assign program_code_free = PROGRAM_CODE_FIFO_DEPTH - st_program_code_level;
+
+    // PROGRAM CODE WINDOW
+    // The program code window is the bytes of the entry at the head of the program code FIFO from
+    // the instruction pointer onwards, with the window size being the number of them that are
+    // valid. Opcodes are parsed one byte per cycle from the start of the window, but operands are
+    // parsed as many bytes per cycle as the window holds.
+
+    logic [31:0] program_code_window;
+    logic [2:0]  program_code_window_size;
+    logic [2:0]  program_code_head_size;
 
     always_comb begin
         case (st_ip)
-            3'h0:    current_byte = st_program_code_buffer[7:0];
-            3'h1:    current_byte = st_program_code_buffer[15:8];
-            3'h2:    current_byte = st_program_code_buffer[23:16];
-            3'h3:    current_byte = st_program_code_buffer[31:24];
-            default: current_byte = 8'h0;
+            2'h0: program_code_window = program_code_head_buffer;
+            2'h1: program_code_window = { 8'h0, program_code_head_buffer[31:8] };
+            2'h2: program_code_window = { 16'h0, program_code_head_buffer[31:16] };
+            2'h3: program_code_window = { 24'h0, program_code_head_buffer[31:24] };
         endcase
     end
 
-    logic leb_last_byte;
+    always_comb begin
+        case (program_code_head_valid)
+            RW_8_BIT:  program_code_head_size = 3'h1;
+            RW_16_BIT: program_code_head_size = 3'h2;
+            RW_32_BIT: program_code_head_size = 3'h4;
+            default:   program_code_head_size = 3'h0;
+        endcase
+    end
 
-    assign leb_last_byte = current_byte[7] == 0;
+    assign program_code_window_size = program_code_head_size - { 1'h0, st_ip };
+
+    // CURRENT BYTE
+    // The current byte is the value of the byte pointed to by the instruction pointer in the entry
+    // at the head of the program code FIFO. This does not consider whether or not the byte is
+    // actually valid.
+
+    logic [7:0] current_byte;
+
+    assign current_byte = program_code_window[7:0];
 
     // CURRENT BYTE VALID
     // The current byte always points to the byte referenced by the instruction pointer, but it is
     // not always valid. The current byte valid flag indicates if the byte is valid and can be used
-    // this cycle.
+    // this cycle. The entry at the head of the program code FIFO is popped when the last byte in
+    // the program code window is parsed.
 
     logic current_byte_valid;
 
     always_comb begin
         case (st_ip)
-            3'h0:    current_byte_valid = program_code_byte_0_valid;
-            3'h1:    current_byte_valid = program_code_byte_1_valid;
-            3'h2:    current_byte_valid = program_code_bytes_2_3_valid;
-            3'h3:    current_byte_valid = program_code_bytes_2_3_valid;
-            default: current_byte_valid = 0;
+            2'h0: current_byte_valid = program_code_byte_0_valid;
+            2'h1: current_byte_valid = program_code_byte_1_valid;
+            2'h2: current_byte_valid = program_code_bytes_2_3_valid;
+            2'h3: current_byte_valid = program_code_bytes_2_3_valid;
         endcase
     end
 
     // OPERAND
     // Opcodes may have a single operand. This operand may be constructed over multiple cycles since
-    // operands can be multiple bytes, and the accelerator only parses one byte per cycle. Only 28
-    // bits are needed since none of the registers are any larger than that, so any larger values
-    // would overflow anyway and so can be safely discarded.
+    // operands can be multiple bytes, and may be split across entries in the program code FIFO.
+    // Every operand byte in the program code window is parsed in the same cycle. Only 28 bits are
+    // needed since none of the registers are any larger than that, so any larger values would
+    // overflow anyway and so can be safely discarded.
 
     logic [27:0] st_operand;
 
@@ -544,70 +755,151 @@ module tqvp_laurie_dwarf_line_table_accelerator(
         if (reset_st_operand)
             st_operand <= 28'h0;
         else if (set_st_operand_from_byte_subtractor)
-            st_operand <= byte_subtractor_dest_zero_extended;
-        else if (parse_leb_128_byte0)
-            st_operand <= {
-                st_leb_signed ? { 21{ current_byte[6] } } : 21'h0,
-                current_byte[6:0]
-            };
-        else if (parse_leb_128_byte1)
-            st_operand <= {
-                st_leb_signed ? { 14{ current_byte[6] } } : 14'h0,
-                current_byte[6:0],
-                st_operand[6:0]
-            };
-        else if (parse_leb_128_byte2)
-            st_operand <= {
-                st_leb_signed ? { 7{ current_byte[6] } } : 7'h0,
-                current_byte[6:0],
-                st_operand[13:0]
-            };
-        else if (parse_leb_128_byte3)
-            st_operand <= { current_byte[6:0], st_operand[20:0] };
-        else if (parse_uint_byte0)
-            st_operand <= { 20'h0, current_byte[7:0] };
-        else if (parse_uint_byte1)
-            st_operand <= { 12'h0, current_byte[7:0], st_operand[7:0] };
-        else if (parse_uint_byte2)
-            st_operand <= { 4'h0, current_byte[7:0], st_operand[15:0] };
-        else if (parse_uint_byte3)
-            st_operand <= { current_byte[3:0], st_operand[23:0] };
+            st_operand <= divider_dividend_zero_extended;
+        else if (set_st_operand_from_divider)
+            st_operand <= divider_dest_zero_extended;
+        else if (parse_leb_128_this_cycle)
+            st_operand <= next_leb_128_operand;
+        else if (parse_uint_this_cycle)
+            st_operand <= next_uint_operand;
     end
 
     logic reset_st_operand;
     logic set_st_operand_from_byte_subtractor;
-    logic parse_leb_128_byte0;
-    logic parse_leb_128_byte1;
-    logic parse_leb_128_byte2;
-    logic parse_leb_128_byte3;
-    logic parse_uint_byte0;
-    logic parse_uint_byte1;
-    logic parse_uint_byte2;
-    logic parse_uint_byte3;
+    logic set_st_operand_from_divider;
+    logic parse_leb_128_this_cycle;
+    logic parse_uint_this_cycle;
+
+    assign reset_st_operand =
+        reset_this_cycle || write_program_header || clear_illegal_this_cycle;
+
+    assign set_st_operand_from_byte_subtractor = parse_special_opcode_or_constaddpc_this_cycle;
 
-    assign reset_st_operand = reset_this_cycle || write_program_header ||
-        (write_status && state_is_pause_for_illegal);
+    assign set_st_operand_from_divider = divide_this_cycle;
 
-    assign set_st_operand_from_byte_subtractor =
-        parse_special_opcode_or_constaddpc_this_cycle || special_opcode_this_cycle;
+    // Bytes of an LEB128 operand past the fourth are parsed but discarded.
+    assign parse_leb_128_this_cycle =
+        parse_operand_this_cycle && state_is_parse_leb_128 && !state_is_parse_leb_128_overflow;
 
-    assign parse_leb_128_byte0 = parse_byte_this_cycle && state_is_parse_leb_128_byte0;
+    assign parse_uint_this_cycle =
+        parse_operand_this_cycle && (state_is_parse_u16 || state_is_parse_u32);
 
-    assign parse_leb_128_byte1 = parse_byte_this_cycle && state_is_parse_leb_128_byte1;
+    // OPERAND LENGTH
+    // The number of operand bytes parsed this cycle. This is every byte in the program code window
+    // up to the end of the operand. LEB128 operands end on the first byte with its top bit clear,
+    // and u16 and u32 operands end when all of their bytes have been parsed. The operand position
+    // is the number of bytes of the operand parsed in earlier cycles, where the LEB128 overflow
+    // state counts as four.
 
-    assign parse_leb_128_byte2 = parse_byte_this_cycle && state_is_parse_leb_128_byte2;
+    logic [2:0] operand_position;
+    logic [2:0] operand_length;
+    logic [3:0] operand_next_position;
+    logic       operand_end;
+    logic [2:0] leb_128_length;
+    logic       leb_128_end;
+    logic [2:0] uint_remaining;
+    logic [2:0] uint_length;
+    logic       uint_end;
 
-    assign parse_leb_128_byte3 = parse_byte_this_cycle && state_is_parse_leb_128_byte3;
+    always_comb begin
+        if (state_is_parse_leb_128_overflow)
+            operand_position = 3'h4;
+        else if (state_is_parse_leb_128_byte3 || state_is_parse_u32_byte3)
+            operand_position = 3'h3;
+        else if (state_is_parse_leb_128_byte2 || state_is_parse_u32_byte2)
+            operand_position = 3'h2;
+        else if (state_is_parse_leb_128_byte1 || state_is_parse_u16_byte1 ||
+                 state_is_parse_u32_byte1)
+            operand_position = 3'h1;
+        else
+            operand_position = 3'h0;
+    end
 
-    assign parse_uint_byte0 =
-        parse_byte_this_cycle && (state_is_parse_u16_byte0 || state_is_parse_u32_byte0);
+    assign operand_length = state_is_parse_leb_128 ? leb_128_length : uint_length;
 
-    assign parse_uint_byte1 =
-        parse_byte_this_cycle && (state_is_parse_u16_byte1 || state_is_parse_u32_byte1);
+    assign operand_next_position = { 1'h0, operand_position } + { 1'h0, operand_length };
 
-    assign parse_uint_byte2 = parse_byte_this_cycle && state_is_parse_u32_byte2;
+    assign operand_end = state_is_parse_leb_128 ? leb_128_end : uint_end;
 
-    assign parse_uint_byte3 = parse_byte_this_cycle && state_is_parse_u32_byte3;
+    always_comb begin
+        if (!program_code_window[7]) begin
+            leb_128_length = 3'h1;
+            leb_128_end    = 1;
+        end else if (program_code_window_size > 3'h1 && !program_code_window[15]) begin
+            leb_128_length = 3'h2;
+            leb_128_end    = 1;
+        end else if (program_code_window_size > 3'h2 && !program_code_window[23]) begin
+            leb_128_length = 3'h3;
+            leb_128_end    = 1;
+        end else if (program_code_window_size > 3'h3 && !program_code_window[31]) begin
+            leb_128_length = 3'h4;
+            leb_128_end    = 1;
+        end else begin
+            leb_128_length = program_code_window_size;
+            leb_128_end    = 0;
+        end
+    end
+
+    assign uint_remaining = (state_is_parse_u16 ? 3'h2 : 3'h4) - operand_position;
+
+    assign uint_end = uint_remaining <= program_code_window_size;
+
+    assign uint_length = uint_end ? uint_remaining : program_code_window_size;
+
+    // OPERAND VALUE
+    // The operand bytes parsed this cycle are placed above the bytes parsed in earlier cycles.
+    // LEB128 operands contribute 7 bits per byte, and signed LEB128 operands are sign-extended from
+    // the last byte parsed, which is only final once the last byte of the operand is parsed.
+
+    logic [27:0] leb_128_window_value;
+    logic [6:0]  leb_128_extension;
+    logic        leb_128_sign;
+    logic [27:0] next_leb_128_operand;
+    logic [27:0] uint_window_value;
+    logic [27:0] next_uint_operand;
+
+    always_comb begin
+        case (leb_128_length)
+            3'h2:    leb_128_sign = program_code_window[14];
+            3'h3:    leb_128_sign = program_code_window[22];
+            3'h4:    leb_128_sign = program_code_window[30];
+            default: leb_128_sign = program_code_window[6];
+        endcase
+    end
+
+    assign leb_128_extension = { 7{ st_leb_signed && leb_128_sign } };
+
+    assign leb_128_window_value = {
+        leb_128_length > 3'h3 ? program_code_window[30:24] : leb_128_extension,
+        leb_128_length > 3'h2 ? program_code_window[22:16] : leb_128_extension,
+        leb_128_length > 3'h1 ? program_code_window[14:8]  : leb_128_extension,
+        program_code_window[6:0]
+    };
+
+    always_comb begin
+        case (operand_position[1:0])
+            2'h0: next_leb_128_operand = leb_128_window_value;
+            2'h1: next_leb_128_operand = { leb_128_window_value[20:0], st_operand[6:0] };
+            2'h2: next_leb_128_operand = { leb_128_window_value[13:0], st_operand[13:0] };
+            2'h3: next_leb_128_operand = { leb_128_window_value[6:0], st_operand[20:0] };
+        endcase
+    end
+
+    assign uint_window_value = {
+        uint_length > 3'h3 ? program_code_window[27:24] : 4'h0,
+        uint_length > 3'h2 ? program_code_window[23:16] : 8'h0,
+        uint_length > 3'h1 ? program_code_window[15:8]  : 8'h0,
+        program_code_window[7:0]
+    };
+
+    always_comb begin
+        case (operand_position[1:0])
+            2'h0: next_uint_operand = uint_window_value;
+            2'h1: next_uint_operand = { uint_window_value[19:0], st_operand[7:0] };
+            2'h2: next_uint_operand = { uint_window_value[11:0], st_operand[15:0] };
+            2'h3: next_uint_operand = { uint_window_value[3:0], st_operand[23:0] };
+        endcase
+    end
 
     logic [27:0] byte_subtractor_dest_zero_extended;
     logic [7:0]  byte_subtractor_dest;
@@ -616,14 +908,77 @@ module tqvp_laurie_dwarf_line_table_accelerator(
 
     assign byte_subtractor_dest_zero_extended = { 20'h0, byte_subtractor_dest };
 
+    // The adjusted opcode is loaded already shifted by the divider steps that are skipped, which
+    // leaves st_operand as those steps would have left it, with their zero quotient bits shifted in.
+    logic [27:0] divider_dividend_zero_extended;
+
+    assign divider_dividend_zero_extended =
+        ph_divider_skipped_steps == 2'h3 ? { 14'h0, byte_subtractor_dest, 6'h0 } :
+        ph_divider_skipped_steps == 2'h2 ? { 16'h0, byte_subtractor_dest, 4'h0 } :
+        ph_divider_skipped_steps == 2'h1 ? { 18'h0, byte_subtractor_dest, 2'h0 } :
+                                           byte_subtractor_dest_zero_extended;
+
     assign byte_subtractor_dest = byte_subtractor_src0 - byte_subtractor_src1;
 
-    assign byte_subtractor_src0 =
-        special_opcode_this_cycle       ? st_operand[7:0] :
-        parse_special_opcode_this_cycle ? current_byte :
-                                          8'hFF;
+    assign byte_subtractor_src0 = parse_special_opcode_this_cycle ? current_byte : 8'hFF;
+
+    assign byte_subtractor_src1 = ph_opcode_base;
+
+    // SPECIAL OPCODE DIVIDER
+    // Special opcodes and const_add_pc divide the adjusted opcode by line_range, giving the address
+    // advance as the quotient and the line advance as the remainder. The adjusted opcode is held in
+    // st_operand[7:0], and is divided two bits per cycle over at most four cycles. The number of
+    // cycles depends only on line_range, never on the opcode, since the leading steps that could
+    // only produce zero quotient bits are skipped for line ranges of 4 or more. Each cycle the next
+    // two bits of the dividend are shifted into the partial remainder in st_operand[15:8], and the
+    // largest multiple of line_range that fits is subtracted. The two quotient bits are shifted
+    // into st_operand[7:0] as the dividend is shifted out, so that after the last step
+    // st_operand[7:0] holds the quotient and st_operand[15:8] holds the remainder.
+
+    logic [27:0] divider_dest_zero_extended;
+    logic [9:0]  divider_partial_remainder;
+    logic [10:0] divider_partial_remainder_minus_x1;
+    logic [10:0] divider_partial_remainder_minus_x2;
+    logic [10:0] divider_partial_remainder_minus_x3;
+    logic [1:0]  divider_quotient_bits;
+    logic [9:0]  divider_remainder;
+
+    assign divider_dest_zero_extended = {
+        12'h0, divider_remainder[7:0], st_operand[5:0], divider_quotient_bits
+    };
+
+    assign divider_partial_remainder = { st_operand[15:8], st_operand[7:6] };
+
+    assign divider_partial_remainder_minus_x1 =
+        { 1'h0, divider_partial_remainder } - { 3'h0, ph_line_range };
 
-    assign byte_subtractor_src1 = special_opcode_this_cycle ? ph_line_range : ph_opcode_base;
+    assign divider_partial_remainder_minus_x2 =
+        { 1'h0, divider_partial_remainder } - { 2'h0, ph_line_range, 1'h0 };
+
+    assign divider_partial_remainder_minus_x3 =
+        { 1'h0, divider_partial_remainder } - { 1'h0, ph_line_range_x3 };
+
+    always_comb begin
+        if (!divider_partial_remainder_minus_x3[10]) begin
+            divider_quotient_bits = 2'h3;
+            divider_remainder     = divider_partial_remainder_minus_x3[9:0];
+        end else if (!divider_partial_remainder_minus_x2[10]) begin
+            divider_quotient_bits = 2'h2;
+            divider_remainder     = divider_partial_remainder_minus_x2[9:0];
+        end else if (!divider_partial_remainder_minus_x1[10]) begin
+            divider_quotient_bits = 2'h1;
+            divider_remainder     = divider_partial_remainder_minus_x1[9:0];
+        end else begin
+            divider_quotient_bits = 2'h0;
+            divider_remainder     = divider_partial_remainder;
+        end
+    end
+
+    logic [27:0] divider_quotient_zero_extended;
+    logic [27:0] divider_remainder_zero_extended;
+
+    assign divider_quotient_zero_extended  = { 20'h0, st_operand[7:0] };
+    assign divider_remainder_zero_extended = { 20'h0, st_operand[15:8] };
 
     // ABSTRACT MACHINE ADDRESS
     // The abstract machine address stores the instruction pointer value calculated by the line
@@ -637,28 +992,23 @@ module tqvp_laurie_dwarf_line_table_accelerator(
         if      (reset_am_address)             am_address <= 28'h0;
         else if (add_operand_to_am_address)    am_address <= main_adder_dest;
         else if (assign_operand_to_am_address) am_address <= st_operand[27:0];
-        else if (increment_am_address)         am_address <= incrementer_dest;
     end
 
     logic reset_am_address;
     logic add_operand_to_am_address;
     logic assign_operand_to_am_address;
-    logic increment_am_address;
 
     assign reset_am_address =
-        reset_this_cycle || write_program_header ||
-        (write_status &&
-            (state_is_pause_for_end_sequence || state_is_pause_for_illegal));
+        reset_this_cycle || write_program_header || retire_end_sequence_this_cycle ||
+        clear_illegal_this_cycle;
 
     assign add_operand_to_am_address =
-        exec_current_instruction_this_cycle && current_instruction_is_advancepc;
+        (exec_current_instruction_this_cycle && current_instruction_is_advancepc) ||
+        advance_address_by_quotient_this_cycle;
 
     assign assign_operand_to_am_address =
         exec_current_instruction_this_cycle && current_instruction_is_setaddress;
 
-    assign increment_am_address =
-        special_opcode_this_cycle && !special_opcode_end_this_cycle;
-
     // ABSTRACT MACHINE FILE
     // The abstract machine address stores the file index calculated by the line table program.
     // There is no fixed size that this should be, so this accelerator assumes that 16-bits should
@@ -675,8 +1025,8 @@ module tqvp_laurie_dwarf_line_table_accelerator(
     logic assign_operand_to_am_file;
 
     assign reset_am_file =
-        reset_this_cycle || write_program_header ||
-        (write_status && (state_is_pause_for_end_sequence || state_is_pause_for_illegal));
+        reset_this_cycle || write_program_header || retire_end_sequence_this_cycle ||
+        clear_illegal_this_cycle;
 
     assign assign_operand_to_am_file =
         exec_current_instruction_this_cycle && current_instruction_is_setfile;
@@ -697,13 +1047,12 @@ module tqvp_laurie_dwarf_line_table_accelerator(
     logic add_src1_to_am_line;
 
     assign reset_am_line =
-        reset_this_cycle || write_program_header ||
-        (write_status && (state_is_pause_for_end_sequence || state_is_pause_for_illegal));
+        reset_this_cycle || write_program_header || retire_end_sequence_this_cycle ||
+        clear_illegal_this_cycle;
 
     assign add_src1_to_am_line =
         (exec_current_instruction_this_cycle && current_instruction_is_advanceline) ||
-        parse_special_opcode_this_cycle ||
-        (special_opcode_end_this_cycle && current_instruction_is_nop);
+        parse_special_opcode_this_cycle || advance_line_by_remainder_this_cycle;
 
     logic [27:0] sign_extended_line_base;
 
@@ -725,8 +1074,8 @@ module tqvp_laurie_dwarf_line_table_accelerator(
     logic assign_operand_to_am_column;
 
     assign reset_am_column =
-        reset_this_cycle || write_program_header ||
-        (write_status && (state_is_pause_for_end_sequence || state_is_pause_for_illegal));
+        reset_this_cycle || write_program_header || retire_end_sequence_this_cycle ||
+        clear_illegal_this_cycle;
 
     assign assign_operand_to_am_column =
         exec_current_instruction_this_cycle && current_instruction_is_setcolumn;
@@ -747,7 +1096,7 @@ module tqvp_laurie_dwarf_line_table_accelerator(
     logic negate_am_is_stmt;
 
     assign reset_am_is_stmt_to_default =
-        (write_status && (state_is_pause_for_end_sequence || state_is_pause_for_illegal));
+        retire_end_sequence_this_cycle || clear_illegal_this_cycle;
 
     assign negate_am_is_stmt = parse_standard_opcode_this_cycle && current_byte_is_lns_negatestmt;
 
@@ -765,8 +1114,8 @@ module tqvp_laurie_dwarf_line_table_accelerator(
     logic set_am_basic_block;
 
     assign reset_am_basic_block =
-        reset_this_cycle || write_program_header ||
-        (write_status && execution_paused);
+        reset_this_cycle || write_program_header || retire_row_this_cycle ||
+        clear_illegal_this_cycle;
 
     assign set_am_basic_block =
         parse_standard_opcode_this_cycle && current_byte_is_lns_setbasicblock;
@@ -785,8 +1134,8 @@ module tqvp_laurie_dwarf_line_table_accelerator(
     logic set_am_end_sequence;
 
     assign reset_am_end_sequence =
-        reset_this_cycle || write_program_header ||
-        (write_status && (state_is_pause_for_end_sequence || state_is_pause_for_illegal));
+        reset_this_cycle || write_program_header || retire_end_sequence_this_cycle ||
+        clear_illegal_this_cycle;
 
     assign set_am_end_sequence =
         parse_extended_opcode_this_cycle && current_byte_is_lne_endsequence;
@@ -805,8 +1154,8 @@ module tqvp_laurie_dwarf_line_table_accelerator(
     logic set_am_prologue_end;
 
     assign reset_am_prologue_end =
-        reset_this_cycle || write_program_header ||
-        (write_status && execution_paused);
+        reset_this_cycle || write_program_header || retire_row_this_cycle ||
+        clear_illegal_this_cycle;
 
     assign set_am_prologue_end =
         parse_standard_opcode_this_cycle && current_byte_is_lns_setprologueend;
@@ -825,8 +1174,8 @@ module tqvp_laurie_dwarf_line_table_accelerator(
     logic set_am_epilogue_begin;
 
     assign reset_am_epilogue_begin =
-        reset_this_cycle || write_program_header ||
-        (write_status && execution_paused);
+        reset_this_cycle || write_program_header || retire_row_this_cycle ||
+        clear_illegal_this_cycle;
 
     assign set_am_epilogue_begin =
         parse_standard_opcode_this_cycle && current_byte_is_lns_setepiloguebegin;
@@ -847,17 +1196,323 @@ module tqvp_laurie_dwarf_line_table_accelerator(
     logic assign_operand_to_am_discriminator;
 
     assign reset_am_discriminator =
-        reset_this_cycle || write_program_header ||
-        (write_status && execution_paused);
+        reset_this_cycle || write_program_header || retire_row_this_cycle ||
+        clear_illegal_this_cycle;
 
     assign assign_operand_to_am_discriminator =
         exec_current_instruction_this_cycle && current_instruction_is_discriminator;
 
+    // ROW FILTER
+    // Rows can be filtered in hardware, so that software looking for the rows covering an address
+    // range only sees the rows it needs. The filter is configured with the FILTER_LO, FILTER_HI,
+    // and FILTER_CTRL registers, and applies from the next row retired. With the address filter
+    // enabled, only rows with an address in [FILTER_LO, FILTER_HI) are reported, along with the row
+    // before the window if it covers FILTER_LO. Since that is only known once a later row of the
+    // same sequence above FILTER_LO is retired, the last row below the window is held in the free
+    // entry at the tail of the row queue until then, and dropped if the next row is at FILTER_LO.
+    // End sequence rows are never held, and are not dropped by the is_stmt filter, so that
+    // sequences are always closed.
+
+    localparam FILTER_CTRL_ADDRESS      = 0;
+    localparam FILTER_CTRL_IS_STMT      = 1;
+    localparam FILTER_CTRL_END_SEQUENCE = 2;
+
+    logic [27:0] filter_lo;
+
+    always_ff @(posedge clk) begin
+        if      (reset_this_cycle) filter_lo <= 28'h0;
+        else if (write_filter_lo)  filter_lo <= next_filter_value[27:0];
+    end
+
+    logic [27:0] filter_hi;
+
+    always_ff @(posedge clk) begin
+        if      (reset_this_cycle) filter_hi <= 28'h0;
+        else if (write_filter_hi)  filter_hi <= next_filter_value[27:0];
+    end
+
+    logic [2:0] filter_ctrl;
+
+    always_ff @(posedge clk) begin
+        if      (reset_this_cycle)  filter_ctrl <= 3'h0;
+        else if (write_filter_ctrl) filter_ctrl <= next_filter_value[2:0];
+    end
+
+    logic st_held_row_valid;
+
+    always_ff @(posedge clk) begin
+        if      (reset_st_held_row_valid) st_held_row_valid <= 0;
+        else if (hold_row_this_cycle)     st_held_row_valid <= 1;
+    end
+
+    logic        write_filter_lo;
+    logic        write_filter_hi;
+    logic        write_filter_ctrl;
+    logic        reset_st_held_row_valid;
+    logic [31:0] filter_register;
+    logic [31:0] next_filter_value;
+    logic        row_passes_flags;
+    logic        row_in_window;
+    logic        row_below_window;
+    logic        row_reported;
+    logic        row_held;
+    logic        row_closes_held_row;
+
+    assign write_filter_lo = write_this_cycle && address_is_filter_lo;
+
+    assign write_filter_hi = write_this_cycle && address_is_filter_hi;
+
+    assign write_filter_ctrl = write_this_cycle && address_is_filter_ctrl;
+
+    assign reset_st_held_row_valid =
+        reset_this_cycle || write_program_header || write_filter_lo || write_filter_hi ||
+        write_filter_ctrl || commit_held_row_this_cycle ||
+        (retire_row_this_cycle && (row_closes_held_row || am_end_sequence));
+
+    assign filter_register =
+        address_is_filter_lo ? { 4'h0, filter_lo } :
+        address_is_filter_hi ? { 4'h0, filter_hi } :
+                               { 29'h0, filter_ctrl };
+
+    assign next_filter_value = {
+        write_byte3_from_byte0 ? data_in[7:0] :
+        write_byte3_from_byte1 ? data_in[15:8] :
+        data_write_32_bit      ? data_in[31:24] :
+                                 filter_register[31:24],
+        write_byte2_from_byte0 ? data_in[7:0] :
+        data_write_32_bit      ? data_in[23:16] :
+                                 filter_register[23:16],
+        write_byte1_from_byte0 ? data_in[7:0] :
+        write_byte1_from_byte1 ? data_in[15:8] :
+                                 filter_register[15:8],
+        write_byte0_from_byte0 ? data_in[7:0] :
+                                 filter_register[7:0]
+    };
+
+    assign row_passes_flags =
+        am_end_sequence || !filter_ctrl[FILTER_CTRL_IS_STMT] || am_is_stmt;
+
+    assign row_in_window =
+        !filter_ctrl[FILTER_CTRL_ADDRESS] ||
+        (!am_address_below_filter_lo && am_address_below_filter_hi);
+
+    assign row_below_window = filter_ctrl[FILTER_CTRL_ADDRESS] && am_address_below_filter_lo;
+
+    assign row_reported =
+        row_passes_flags &&
+        (row_in_window || (filter_ctrl[FILTER_CTRL_END_SEQUENCE] && am_end_sequence));
+
+    assign row_held = row_passes_flags && row_below_window && !am_end_sequence;
+
+    assign row_closes_held_row = row_passes_flags && !row_below_window;
+
+    // ROW QUEUE
+    // Emitted rows are pushed on to a small queue of snapshots of the abstract machine state, so
+    // that execution can continue while the host reads the row. The row at the head of the queue
+    // is read through the AM registers, and popped by a write to ROW_POP or STATUS. When the queue
+    // is empty, the AM registers read the live abstract machine state instead. Rows are stored in
+    // the format of the AM_LINE_COL_FLAGS, AM_FILE_DISCRIM, and AM_ADDRESS registers, without
+    // their unused bits. A held row is written to the entry at the tail of the queue, but is only
+    // counted as queued once it is committed.
+
+    localparam [1:0] ROW_QUEUE_DEPTH = 2'h2;
+
+    logic [90:0] st_row_queue [ROW_QUEUE_DEPTH];
+
+    always_ff @(posedge clk) begin
+        if (write_row_queue_tail) st_row_queue[st_row_queue_tail] <= am_row;
+    end
+
+    logic st_row_queue_head;
+
+    always_ff @(posedge clk) begin
+        if      (reset_st_row_queue) st_row_queue_head <= 0;
+        else if (pop_row)            st_row_queue_head <= !st_row_queue_head;
+    end
+
+    logic st_row_queue_tail;
+
+    always_ff @(posedge clk) begin
+        if      (reset_st_row_queue) st_row_queue_tail <= 0;
+        else if (queue_row)          st_row_queue_tail <= !st_row_queue_tail;
+    end
+
+    logic [1:0] st_row_queue_level;
+
+    always_ff @(posedge clk) begin
+        if      (reset_st_row_queue)        st_row_queue_level <= 2'h0;
+        else if (increment_row_queue_level) st_row_queue_level <= st_row_queue_level + 2'h1;
+        else if (decrement_row_queue_level) st_row_queue_level <= st_row_queue_level - 2'h1;
+    end
+
+    logic        reset_st_row_queue;
+    logic        write_row_pop;
+    logic        write_row_queue_tail;
+    logic        queue_row;
+    logic        increment_row_queue_level;
+    logic        decrement_row_queue_level;
+    logic [90:0] am_row;
+    logic [90:0] row_queue_head;
+
+    assign reset_st_row_queue = reset_this_cycle || write_program_header;
+
+    assign write_row_pop = write_this_cycle && address_is_row_pop;
+
+    assign write_row_queue_tail = push_row_this_cycle || hold_row_this_cycle;
+
+    assign queue_row = push_row_this_cycle || commit_held_row_this_cycle;
+
+    assign increment_row_queue_level = queue_row && !pop_row;
+
+    assign decrement_row_queue_level = pop_row && !queue_row;
+
+    assign am_row = {
+        am_epilogue_begin, am_prologue_end, am_end_sequence, am_basic_block, am_is_stmt, am_column,
+        am_line, am_discriminator, am_file, am_address
+    };
+
+    assign row_queue_head = st_row_queue[st_row_queue_head];
+
+    // ROW DELTA
+    // The row at the head of the row queue can be read in a single register read, by packing it as
+    // a delta from the previous row popped from the queue. Rows that change the file, have a
+    // discriminator, or advance the address or line too far to fit, set the escape bit instead, and
+    // must be read through the AM registers. The previous row is reset to the initial state of the
+    // abstract machine at the start of the program and after each end sequence row, so that it
+    // tracks the same row as software reconstructing the rows from the deltas.
+
+    localparam [27:0] INITIAL_ADDRESS = 28'h0;
+    localparam [15:0] INITIAL_FILE    = 16'h1;
+    localparam [15:0] INITIAL_LINE    = 16'h1;
+
+    logic [27:0] prev_row_address;
+
+    always_ff @(posedge clk) begin
+        if      (reset_prev_row) prev_row_address <= INITIAL_ADDRESS;
+        else if (pop_row)        prev_row_address <= head_row_address;
+    end
+
+    logic [15:0] prev_row_file;
+
+    always_ff @(posedge clk) begin
+        if      (reset_prev_row) prev_row_file <= INITIAL_FILE;
+        else if (pop_row)        prev_row_file <= head_row_file;
+    end
+
+    logic [15:0] prev_row_line;
+
+    always_ff @(posedge clk) begin
+        if      (reset_prev_row) prev_row_line <= INITIAL_LINE;
+        else if (pop_row)        prev_row_line <= head_row_line;
+    end
+
+    logic        reset_prev_row;
+    logic [27:0] head_row_address;
+    logic [15:0] head_row_file;
+    logic [15:0] head_row_discriminator;
+    logic [15:0] head_row_line;
+    logic [14:0] head_row_flags_column;
+    logic        head_row_end_sequence;
+    logic [27:0] row_delta_address;
+    logic [15:0] row_delta_line;
+    logic        row_delta_address_fits;
+    logic        row_delta_line_fits;
+    logic        row_delta_escape;
+    logic [31:0] out_row_delta;
+
+    assign reset_prev_row =
+        reset_this_cycle || write_program_header || (pop_row && head_row_end_sequence);
+
+    assign head_row_address       = row_queue_head[27:0];
+    assign head_row_file          = row_queue_head[43:28];
+    assign head_row_discriminator = row_queue_head[59:44];
+    assign head_row_line          = row_queue_head[75:60];
+    assign head_row_flags_column  = row_queue_head[90:76];
+    assign head_row_end_sequence  = row_queue_head[88];
+
+    assign row_delta_address = head_row_address - prev_row_address;
+
+    assign row_delta_line = head_row_line - prev_row_line;
+
+    // The address delta is unsigned, and the line delta is signed.
+    assign row_delta_address_fits = !(|row_delta_address[27:8]);
+
+    assign row_delta_line_fits = &row_delta_line[15:6] || !(|row_delta_line[15:6]);
+
+    assign row_delta_escape =
+        head_row_file != prev_row_file || (|head_row_discriminator) || !row_delta_address_fits ||
+        !row_delta_line_fits;
+
+    // The flags and column are in the same order as in AM_LINE_COL_FLAGS.
+    assign out_row_delta = row_queue_empty ? 32'h0 : {
+        1'h1, row_delta_escape, head_row_flags_column, row_delta_address[7:0], row_delta_line[6:0]
+    };
+
+    // INTERRUPT
+    // The interrupt lets software wait for the peripheral to need attention, rather than polling
+    // STATUS. It is raised while rows are queued, while the peripheral is paused on an illegal
+    // instruction, once the peripheral goes from busy to ready, and while the program code FIFO has
+    // room for a burst of writes, each enabled by a bit in INT_MASK. Rows, illegal, and code space
+    // are levels that clear when the rows are popped, the illegal state is cleared, or the FIFO is
+    // refilled. Ready is latched when the peripheral runs out of code, and acknowledged by the next
+    // write to PROGRAM_CODE or PROGRAM_HEADER. Writes to INT_MASK don't acknowledge it, so a driver
+    // can disable code space once the program is written without losing the end of the program.
+
+    localparam INT_MASK_EMIT_ROW = 0;
+    localparam INT_MASK_ILLEGAL  = 1;
+    localparam INT_MASK_READY    = 2;
+    localparam INT_MASK_CODE     = 3;
+
+    // The code space source is active while at least this many program code FIFO entries are free,
+    // so each interrupt is worth a burst of writes rather than a single one.
+    localparam [2:0] INT_CODE_FREE_THRESHOLD = 3'h2;
+
+    logic [3:0] int_mask;
+
+    always_ff @(posedge clk) begin
+        if      (reset_this_cycle) int_mask <= 4'h0;
+        else if (write_int_mask)   int_mask <= data_in[3:0];
+    end
+
+    logic st_was_busy;
+
+    always_ff @(posedge clk) begin
+        st_was_busy <= peripheral_busy;
+    end
+
+    logic st_ready_pending;
+
+    always_ff @(posedge clk) begin
+        if      (reset_st_ready_pending) st_ready_pending <= 0;
+        else if (set_st_ready_pending)   st_ready_pending <= 1;
+    end
+
+    logic write_int_mask;
+    logic peripheral_busy;
+    logic reset_st_ready_pending;
+    logic set_st_ready_pending;
+
+    assign write_int_mask = write_this_cycle && write_byte0_from_byte0 && address_is_int_mask;
+
+    assign reset_st_ready_pending =
+        reset_this_cycle || write_program_header || write_program_code;
+
+    // Execution is only paused by a write for a cycle, so that doesn't count as going ready.
+    assign peripheral_busy = status_is_busy || state_is_exec;
+
+    assign set_st_ready_pending = st_was_busy && !peripheral_busy;
+
+    assign user_interrupt =
+        (int_mask[INT_MASK_EMIT_ROW] && status_is_emit_row) ||
+        (int_mask[INT_MASK_ILLEGAL] && state_is_pause_for_illegal) ||
+        (int_mask[INT_MASK_READY] && st_ready_pending) ||
+        (int_mask[INT_MASK_CODE] && program_code_free >= INT_CODE_FREE_THRESHOLD);
+
     // REGISTER OUTPUTS
     // This logic composes the internal state into the format of the public facing memory mapped
     // registers, and selects which if any to write back over the SPI.
 
-    localparam VERSION_INFO = 32'h00000155;
+    localparam VERSION_INFO = 32'h00000255;
 
     assign data_out[7:0] =
         read_byte0_from_byte0 ? out_register[7:0] : 
@@ -882,6 +1537,8 @@ module tqvp_laurie_dwarf_line_table_accelerator(
     logic [31:0] out_am_file_descrim;
     logic [31:0] out_am_line_col_flags;
     logic [1:0]  out_status;
+    logic [90:0] out_row;
+    logic [31:0] out_code_fifo;
 
     assign out_register = data_read_valid_alignment ? out_selected_register : 32'h0;
 
@@ -891,8 +1548,14 @@ module tqvp_laurie_dwarf_line_table_accelerator(
             AM_ADDRESS:        out_selected_register = out_am_address;
             AM_FILE_DISCRIM:   out_selected_register = out_am_file_descrim;
             AM_LINE_COL_FLAGS: out_selected_register = out_am_line_col_flags;
-            STATUS:            out_selected_register = { 30'h0, out_status };
+            STATUS:            out_selected_register = { 28'h0, st_row_queue_level, out_status };
             INFO:              out_selected_register = VERSION_INFO;
+            CODE_FIFO:         out_selected_register = out_code_fifo;
+            FILTER_LO:         out_selected_register = { 4'h0, filter_lo };
+            FILTER_HI:         out_selected_register = { 4'h0, filter_hi };
+            FILTER_CTRL:       out_selected_register = { 29'h0, filter_ctrl };
+            ROW_DELTA:         out_selected_register = out_row_delta;
+            INT_MASK:          out_selected_register = { 28'h0, int_mask };
             default:           out_selected_register = 32'h0;
         endcase
     end
@@ -901,18 +1564,20 @@ module tqvp_laurie_dwarf_line_table_accelerator(
         ph_opcode_base, ph_line_range, ph_line_base, 7'h0, ph_default_is_stmt
     };
 
-    assign out_am_address = { 4'h0, am_address };
+    assign out_row = row_queue_empty ? am_row : row_queue_head;
 
-    assign out_am_file_descrim = { am_discriminator, am_file };
+    assign out_am_address = { 4'h0, out_row[27:0] };
 
-    assign out_am_line_col_flags = {
-        1'h0, am_epilogue_begin, am_prologue_end, am_end_sequence, am_basic_block, am_is_stmt,
-        am_column, am_line
-    };
+    assign out_am_file_descrim = out_row[59:28];
+
+    assign out_am_line_col_flags = { 1'h0, out_row[90:60] };
 
+    assign out_code_fifo = { 24'h0, 1'h0, st_program_code_level, 1'h0, program_code_free };
+
+    // Rows queued before an illegal instruction are reported before the illegal instruction.
     always_comb begin
-        if      (state_is_pause_for_illegal) out_status = STATUS_ILLEGAL;
-        else if (status_is_emit_row)         out_status = STATUS_EMIT_ROW;
+        if      (status_is_emit_row)         out_status = STATUS_EMIT_ROW;
+        else if (state_is_pause_for_illegal) out_status = STATUS_ILLEGAL;
         else if (status_is_busy)             out_status = STATUS_BUSY;
         else                                 out_status = STATUS_READY;
     end
@@ -920,10 +1585,11 @@ module tqvp_laurie_dwarf_line_table_accelerator(
     logic status_is_emit_row;
     logic status_is_busy;
 
-    assign status_is_emit_row = state_is_pause_for_emit_row || state_is_pause_for_end_sequence;
+    assign status_is_emit_row = !row_queue_empty;
 
     assign status_is_busy =
-        current_byte_valid || state_is_special_opcode || exec_current_instruction_this_cycle;
+        current_byte_valid || state_is_special_opcode || exec_current_instruction_this_cycle ||
+        state_is_pause_for_emit_row || state_is_pause_for_end_sequence;
 
     // DEFERRED RESET
     // The input rst_n is synchronised on the falling edge, creating tighter timing on logic chains
@@ -937,9 +1603,8 @@ module tqvp_laurie_dwarf_line_table_accelerator(
     end
 
     // SHARED ADDERS
-    // There are several places using a general adder, and a couple using a special case adder where
-    // one of the operands is always one, and many of these cases will not run in the same cycle.
-    // These adders are a shared resource.
+    // There are several places using a general adder, and many of these cases will not run in the
+    // same cycle. This adder is a shared resource.
 
     logic [27:0] main_adder_dest;
     logic [27:0] main_adder_src0;
@@ -954,18 +1619,10 @@ module tqvp_laurie_dwarf_line_table_accelerator(
 
     assign main_adder_src1 =
         parse_special_opcode_or_constaddpc_this_cycle ? sign_extended_line_base :
+        advance_address_by_quotient_this_cycle        ? divider_quotient_zero_extended :
+        advance_line_by_remainder_this_cycle          ? divider_remainder_zero_extended :
                                                         st_operand;
 
-    logic [27:0] incrementer_dest;
-    logic [27:0] incrementer_src0;
-
-    assign incrementer_dest = incrementer_src0 + 28'h1;
-
-    assign incrementer_src0 =
-        parse_byte_this_cycle ? { 25'h0, st_ip } :
-        increment_am_address  ? am_address :
-        28'h0;
-
     // COMMON COMPARISONS
     // A series of common comparisons, done in one place.
 
@@ -1053,12 +1710,39 @@ module tqvp_laurie_dwarf_line_table_accelerator(
     logic program_code_byte_1_valid;
     logic program_code_bytes_2_3_valid;
 
-    assign program_code_byte_0_valid    = !(&st_program_code_valid);
-    assign program_code_byte_1_valid    = st_program_code_valid[0] != st_program_code_valid[1];
-    assign program_code_bytes_2_3_valid = st_program_code_valid == RW_32_BIT;
+    assign program_code_byte_0_valid    = !(&program_code_head_valid);
+    assign program_code_byte_1_valid    = program_code_head_valid[0] != program_code_head_valid[1];
+    assign program_code_bytes_2_3_valid = program_code_head_valid == RW_32_BIT;
+
+    logic am_address_below_filter_lo;
+    logic am_address_at_filter_lo;
+    logic am_address_below_filter_hi;
+
+    assign am_address_below_filter_lo = am_address < filter_lo;
+    assign am_address_at_filter_lo    = am_address == filter_lo;
+    assign am_address_below_filter_hi = am_address < filter_hi;
+
+    logic row_queue_empty;
+    logic row_queue_full;
+
+    assign row_queue_empty = st_row_queue_level == 2'h0;
+    assign row_queue_full  = st_row_queue_level == ROW_QUEUE_DEPTH;
+
+    logic program_code_fifo_empty;
+    logic program_code_fifo_full;
+
+    assign program_code_fifo_empty = st_program_code_level == 3'h0;
+    assign program_code_fifo_full  = st_program_code_level == PROGRAM_CODE_FIFO_DEPTH;
 
     logic state_is_exec;
     logic state_is_special_opcode;
+    logic state_is_special_opcode_divide0;
+    logic state_is_special_opcode_divide1;
+    logic state_is_special_opcode_divide2;
+    logic state_is_special_opcode_divide3;
+    logic state_is_special_opcode_divide;
+    logic state_is_special_opcode_advance_address;
+    logic state_is_special_opcode_advance_line;
     logic state_is_extended_opcode;
     logic state_is_ready;
     logic state_is_pause_for_emit_row;
@@ -1075,9 +1759,30 @@ module tqvp_laurie_dwarf_line_table_accelerator(
     logic state_is_parse_u32_byte1;
     logic state_is_parse_u32_byte2;
     logic state_is_parse_u32_byte3;
+    logic state_is_parse_leb_128;
+    logic state_is_parse_u16;
+    logic state_is_parse_u32;
+    logic state_is_parse_operand;
 
     assign state_is_exec                   = st_state == STATE_EXEC;
-    assign state_is_special_opcode         = st_state == STATE_SPECIAL_OPCODE;
+    assign state_is_special_opcode_divide0 = st_state == STATE_SPECIAL_OPCODE_DIVIDE0;
+    assign state_is_special_opcode_divide1 = st_state == STATE_SPECIAL_OPCODE_DIVIDE1;
+    assign state_is_special_opcode_divide2 = st_state == STATE_SPECIAL_OPCODE_DIVIDE2;
+    assign state_is_special_opcode_divide3 = st_state == STATE_SPECIAL_OPCODE_DIVIDE3;
+
+    assign state_is_special_opcode_advance_address =
+        st_state == STATE_SPECIAL_OPCODE_ADVANCE_ADDRESS;
+
+    assign state_is_special_opcode_advance_line = st_state == STATE_SPECIAL_OPCODE_ADVANCE_LINE;
+
+    assign state_is_special_opcode_divide =
+        state_is_special_opcode_divide0 || state_is_special_opcode_divide1 ||
+        state_is_special_opcode_divide2 || state_is_special_opcode_divide3;
+
+    assign state_is_special_opcode =
+        state_is_special_opcode_divide || state_is_special_opcode_advance_address ||
+        state_is_special_opcode_advance_line;
+
     assign state_is_extended_opcode        = st_state == STATE_EXTENDED_OPCODE;
     assign state_is_ready                  = st_state == STATE_READY;
     assign state_is_pause_for_emit_row     = st_state == STATE_PAUSE_FOR_EMIT_ROW;
@@ -1095,6 +1800,20 @@ module tqvp_laurie_dwarf_line_table_accelerator(
     assign state_is_parse_u32_byte2        = st_state == STATE_PARSE_U32_BYTE2;
     assign state_is_parse_u32_byte3        = st_state == STATE_PARSE_U32_BYTE3;
 
+    assign state_is_parse_leb_128 =
+        state_is_parse_leb_128_byte0 || state_is_parse_leb_128_byte1 ||
+        state_is_parse_leb_128_byte2 || state_is_parse_leb_128_byte3 ||
+        state_is_parse_leb_128_overflow;
+
+    assign state_is_parse_u16 = state_is_parse_u16_byte0 || state_is_parse_u16_byte1;
+
+    assign state_is_parse_u32 =
+        state_is_parse_u32_byte0 || state_is_parse_u32_byte1 || state_is_parse_u32_byte2 ||
+        state_is_parse_u32_byte3;
+
+    assign state_is_parse_operand =
+        state_is_parse_leb_128 || state_is_parse_u16 || state_is_parse_u32;
+
     logic current_byte_is_lns_copy;
     logic current_byte_is_lns_advancepc;
     logic current_byte_is_lns_advanceline;
@@ -1136,10 +1855,22 @@ module tqvp_laurie_dwarf_line_table_accelerator(
     logic address_is_status;
     logic address_is_program_header;
     logic address_is_program_code;
+    logic address_is_row_pop;
+    logic address_is_filter_lo;
+    logic address_is_filter_hi;
+    logic address_is_filter_ctrl;
+    logic address_is_row_delta;
+    logic address_is_int_mask;
 
     assign address_is_status         = address[5:2] == STATUS;
     assign address_is_program_header = address[5:2] == PROGRAM_HEADER;
     assign address_is_program_code   = address[5:2] == PROGRAM_CODE;
+    assign address_is_row_pop        = address[5:2] == ROW_POP;
+    assign address_is_filter_lo      = address[5:2] == FILTER_LO;
+    assign address_is_filter_hi      = address[5:2] == FILTER_HI;
+    assign address_is_filter_ctrl    = address[5:2] == FILTER_CTRL;
+    assign address_is_row_delta      = address[5:2] == ROW_DELTA;
+    assign address_is_int_mask       = address[5:2] == INT_MASK;
 
     logic current_instruction_is_nop;
     logic current_instruction_is_constaddpc;
@@ -1161,13 +1892,53 @@ module tqvp_laurie_dwarf_line_table_accelerator(
     assign current_instruction_is_setcolumn     = st_current_instruction == INSTR_SETCOLUMN;
     assign current_instruction_is_discriminator = st_current_instruction == INSTR_SETDISCRIMINATOR;
 
+    // CAPTURE
+    // The state machine, current instruction and the occupancy of the program code FIFO and row
+    // queue, gathered into one signal that the ris-test testbench samples every cycle for its
+    // failure waveforms, since the ports alone don't show what the peripheral was doing. Nothing in
+    // the design reads it, so it is removed by synthesis.
+
+    logic [13:0] capture_state /* verilator public_flat_rd */;
+
+    assign capture_state = {
+        st_row_queue_level,
+        st_program_code_level,
+        st_current_instruction,
+        st_state
+    };
+
+    // COVERAGE
+    // The state, current instruction and control strobes, gathered into one signal that the ris-test
+    // testbench samples every cycle to measure which paths through the design a test has exercised.
+    // Nothing in the design reads it either.
+
+    logic [21:0] coverage_state /* verilator public_flat_rd */;
+
+    assign coverage_state = {
+        clear_illegal_this_cycle,
+        ack_row_delta_this_cycle,
+        retire_row_this_cycle,
+        commit_held_row_this_cycle,
+        hold_row_this_cycle,
+        push_row_this_cycle,
+        divide_this_cycle,
+        parse_operand_this_cycle,
+        parse_byte_this_cycle,
+        exec_current_instruction_this_cycle,
+        write_pauses_execution_this_cycle,
+        write_this_cycle,
+        ph_opcode_base < 8'h0D,
+        st_current_instruction,
+        st_state
+    };
+
     // UNUSED
-    // Pmod and interrupt interfaces are unused. Drive the outputs to 0 and mark the Pmod inputs as
-    // unused to avoid warnings.
+    // Pmod interface is unused. Drive the outputs to 0 and mark the Pmod inputs as unused to avoid
+    // warnings. The capture and coverage state are only read by the testbench.
 
     assign uo_out[7:0]    = 8'h0;
 
-    wire _unused  = &{ ui_in };
+    wire _unused  = &{ ui_in, capture_state, coverage_state };
 
     // DEBUG
     // Enable to dump the waves when running under verilator.
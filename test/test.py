@@ -17,6 +17,24 @@ class MmReg:
     AM_LINE_COL_FLAGS = 0x10
     STATUS            = 0x14
     INFO              = 0x18
+    CODE_FIFO         = 0x1C
+    ROW_POP           = 0x20
+    FILTER_LO         = 0x24
+    FILTER_HI         = 0x28
+    FILTER_CTRL       = 0x2C
+    ROW_DELTA         = 0x30
+    INT_MASK          = 0x34
+
+class IntMask:
+    EMIT_ROW = 0x1
+    ILLEGAL  = 0x2
+    READY    = 0x4
+    CODE     = 0x8
+
+class FilterCtrl:
+    ADDRESS      = 0x1
+    IS_STMT      = 0x2
+    END_SEQUENCE = 0x4
 
 class StatusCode:
     READY    = 0
@@ -24,6 +42,14 @@ class StatusCode:
     BUSY     = 2
     ILLEGAL  = 3
 
+# The number of rows in the row queue is in bits 3:2 of STATUS.
+def status_with_rows(status_code, rows):
+    return (rows << 2) | status_code
+
+# Pack the fields of ROW_DELTA, with the flags in the same order as AM_LINE_COL_FLAGS.
+def row_delta(escape, flags, column, address_delta, line_delta):
+    return (1 << 31) | (escape << 30) | (flags << 25) | (column << 15) | (address_delta << 7) | (line_delta & 0x7F)
+
 class StandardOpcode:
     DwLnsCopy             = 0x01
     DwLnsAdvancePc        = 0x02
@@ -59,7 +85,12 @@ async def test_register_read_write_reset(dut):
     assert await tqv.read_byte_reg(MmReg.AM_FILE_DISCRIM)   == 0x1
     assert await tqv.read_word_reg(MmReg.AM_LINE_COL_FLAGS) == 0x1
     assert await tqv.read_word_reg(MmReg.STATUS)            == StatusCode.READY
-    assert await tqv.read_word_reg(MmReg.INFO)              == 0x00000155
+    assert await tqv.read_word_reg(MmReg.INFO)              == 0x00000255
+    assert await tqv.read_word_reg(MmReg.CODE_FIFO)         == 0x00000004
+    assert await tqv.read_word_reg(MmReg.FILTER_LO)         == 0x0
+    assert await tqv.read_word_reg(MmReg.FILTER_HI)         == 0x0
+    assert await tqv.read_word_reg(MmReg.FILTER_CTRL)       == 0x0
+    assert await tqv.read_word_reg(MmReg.INT_MASK)          == 0x0
 
     # test default value of is_stmt updated on new program header
     await tqv.write_word_reg(MmReg.PROGRAM_HEADER, 0x0D010001)
@@ -77,7 +108,9 @@ async def test_register_read_write_reset(dut):
     await tqv.write_word_reg(MmReg.STATUS, 0xABCD1234)
     assert await tqv.read_word_reg(MmReg.STATUS) == StatusCode.READY
     await tqv.write_word_reg(MmReg.INFO, 0xABCD1234)
-    assert await tqv.read_word_reg(MmReg.INFO) == 0x00000155
+    assert await tqv.read_word_reg(MmReg.INFO) == 0x00000255
+    await tqv.write_word_reg(MmReg.CODE_FIFO, 0xABCD1234)
+    assert await tqv.read_word_reg(MmReg.CODE_FIFO) == 0x00000004
 
     # test writes to read-write registers
     await tqv.write_word_reg(MmReg.PROGRAM_HEADER, 0xABCD2301)
@@ -104,6 +137,13 @@ async def test_register_read_write_reset(dut):
         MmReg.AM_LINE_COL_FLAGS,
         MmReg.STATUS,
         MmReg.INFO,
+        MmReg.CODE_FIFO,
+        MmReg.ROW_POP,
+        MmReg.FILTER_LO,
+        MmReg.FILTER_HI,
+        MmReg.FILTER_CTRL,
+        MmReg.ROW_DELTA,
+        MmReg.INT_MASK,
     ])
     for illegal_reg in [i for i in range(64) if i not in real_registers]:
         await tqv.write_word_reg(illegal_reg, 0xFFFFFFFF)
@@ -340,16 +380,16 @@ async def test_partial_status_access(dut):
 
     assert await tqv.read_word_reg(MmReg.STATUS) == StatusCode.READY
     await tqv.write_byte_reg(MmReg.PROGRAM_CODE, StandardOpcode.DwLnsCopy)
-    assert await tqv.read_word_reg(MmReg.STATUS) == StatusCode.EMIT_ROW
+    assert await tqv.read_word_reg(MmReg.STATUS) == status_with_rows(StatusCode.EMIT_ROW, 1)
 
     # test read each byte of status individually
-    assert await tqv.read_byte_reg(MmReg.STATUS)     == StatusCode.EMIT_ROW
+    assert await tqv.read_byte_reg(MmReg.STATUS)     == status_with_rows(StatusCode.EMIT_ROW, 1)
     assert await tqv.read_byte_reg(MmReg.STATUS + 1) == 0x00
     assert await tqv.read_byte_reg(MmReg.STATUS + 2) == 0x00
     assert await tqv.read_byte_reg(MmReg.STATUS + 3) == 0x00
 
     # test read each nibble of status individually
-    assert await tqv.read_hword_reg(MmReg.STATUS)     == StatusCode.EMIT_ROW
+    assert await tqv.read_hword_reg(MmReg.STATUS)     == status_with_rows(StatusCode.EMIT_ROW, 1)
     assert await tqv.read_hword_reg(MmReg.STATUS + 2) == 0x0000
 
     # test misaligned word reads of status return 0
@@ -363,12 +403,12 @@ async def test_partial_status_access(dut):
     # test misaligned word writes to status are ignored
     for i in [1, 2, 3]:
         await tqv.write_word_reg(MmReg.STATUS + i, 0)
-        assert await tqv.read_word_reg(MmReg.STATUS) == StatusCode.EMIT_ROW
+        assert await tqv.read_word_reg(MmReg.STATUS) == status_with_rows(StatusCode.EMIT_ROW, 1)
 
     # test misaligned nibble writes to status are ignored
     for i in [1, 3]:
         await tqv.write_hword_reg(MmReg.STATUS + i, 0)
-        assert await tqv.read_word_reg(MmReg.STATUS) == StatusCode.EMIT_ROW
+        assert await tqv.read_word_reg(MmReg.STATUS) == status_with_rows(StatusCode.EMIT_ROW, 1)
 
     # test aligned word write to status is accepted
     await tqv.write_word_reg(MmReg.STATUS, 0)
@@ -377,14 +417,14 @@ async def test_partial_status_access(dut):
     # test all byte writes to status are accepted
     for i in range(4):
         await tqv.write_byte_reg(MmReg.PROGRAM_CODE, StandardOpcode.DwLnsCopy)
-        assert await tqv.read_word_reg(MmReg.STATUS) == StatusCode.EMIT_ROW
+        assert await tqv.read_word_reg(MmReg.STATUS) == status_with_rows(StatusCode.EMIT_ROW, 1)
         await tqv.write_byte_reg(MmReg.STATUS, i)
         assert await tqv.read_word_reg(MmReg.STATUS) == StatusCode.READY
 
     # test all aligned nibble writes to status are accepted
     for i in [0, 2]:
         await tqv.write_byte_reg(MmReg.PROGRAM_CODE, StandardOpcode.DwLnsCopy)
-        assert await tqv.read_word_reg(MmReg.STATUS) == StatusCode.EMIT_ROW
+        assert await tqv.read_word_reg(MmReg.STATUS) == status_with_rows(StatusCode.EMIT_ROW, 1)
         await tqv.write_hword_reg(MmReg.STATUS, i)
         assert await tqv.read_word_reg(MmReg.STATUS) == StatusCode.READY
 
@@ -396,16 +436,16 @@ async def test_partial_info_access(dut):
     tqv = TinyQV(dut, PERIPHERAL_NUM)
     await tqv.reset()
 
-    assert await tqv.read_word_reg(MmReg.INFO) == 0x00000155
+    assert await tqv.read_word_reg(MmReg.INFO) == 0x00000255
 
     # test read each byte of info individually
     assert await tqv.read_byte_reg(MmReg.INFO)     == 0x55
-    assert await tqv.read_byte_reg(MmReg.INFO + 1) == 0x01
+    assert await tqv.read_byte_reg(MmReg.INFO + 1) == 0x02
     assert await tqv.read_byte_reg(MmReg.INFO + 2) == 0x00
     assert await tqv.read_byte_reg(MmReg.INFO + 3) == 0x00
 
     # test read each nibble of info individually
-    assert await tqv.read_hword_reg(MmReg.INFO)     == 0x0155
+    assert await tqv.read_hword_reg(MmReg.INFO)     == 0x0255
     assert await tqv.read_hword_reg(MmReg.INFO + 2) == 0x0000
 
     # test misaligned word reads of info return 0
@@ -419,11 +459,394 @@ async def test_partial_info_access(dut):
     # test all writes to info are ignored
     for i in range(4):
         await tqv.write_byte_reg(MmReg.INFO + i, 0x11)
-        assert await tqv.read_word_reg(MmReg.INFO) == 0x00000155
+        assert await tqv.read_word_reg(MmReg.INFO) == 0x00000255
         await tqv.write_hword_reg(MmReg.INFO + i, 0x1111)
-        assert await tqv.read_word_reg(MmReg.INFO) == 0x00000155
+        assert await tqv.read_word_reg(MmReg.INFO) == 0x00000255
         await tqv.write_word_reg(MmReg.INFO + i, 0x11111111)
-        assert await tqv.read_word_reg(MmReg.INFO) == 0x00000155
+        assert await tqv.read_word_reg(MmReg.INFO) == 0x00000255
+
+@cocotb.test()
+async def test_program_code_fifo(dut):
+    clock = Clock(dut.clk, 100, units="ns")
+    cocotb.start_soon(clock.start())
+
+    tqv = TinyQV(dut, PERIPHERAL_NUM)
+    await tqv.reset()
+
+    # test fifo starts empty, with every entry free
+    assert await tqv.read_word_reg(MmReg.CODE_FIFO)      == 0x04
+    assert await tqv.read_byte_reg(MmReg.CODE_FIFO)      == 0x04
+    assert await tqv.read_hword_reg(MmReg.CODE_FIFO + 2) == 0x00
+
+    # test entries are popped once all their bytes are parsed
+    await tqv.write_byte_reg(MmReg.PROGRAM_CODE, StandardOpcode.DwLnsCopy)
+    assert await wait_for_status_code(dut, tqv, StatusCode.EMIT_ROW, 10)
+    assert await tqv.read_word_reg(MmReg.CODE_FIFO) == 0x04
+    await tqv.write_byte_reg(MmReg.ROW_POP, 0)
+
+    # test a burst of writes fills the fifo while execution is stalled on a full row queue
+    await stall_on_full_row_queue(dut, tqv)
+    basic_block_then_copy = (StandardOpcode.DwLnsCopy << 24) | (StandardOpcode.DwLnsSetBasicBlock << 16) | \
+                            (StandardOpcode.DwLnsSetBasicBlock << 8) | StandardOpcode.DwLnsSetBasicBlock
+    for level in range(1, 5):
+        await tqv.write_word_reg(MmReg.PROGRAM_CODE, basic_block_then_copy)
+        assert await tqv.read_word_reg(MmReg.CODE_FIFO) == (level << 4) | (4 - level)
+
+    # test writes to a full fifo are discarded
+    await tqv.write_byte_reg(MmReg.PROGRAM_CODE, StandardOpcode.DwLnsCopy)
+    assert await tqv.read_word_reg(MmReg.CODE_FIFO) == 0x40
+
+    # test each entry is executed in order as the fifo drains
+    for level in range(3, -1, -1):
+        await tqv.write_byte_reg(MmReg.ROW_POP, 0)
+        assert await wait_for_status_code(dut, tqv, StatusCode.EMIT_ROW, 10)
+        assert await tqv.read_word_reg(MmReg.CODE_FIFO) == (level << 4) | (4 - level)
+    rows = 0
+    while await read_status_code(tqv) == StatusCode.EMIT_ROW:
+        assert await read_am_basic_block(tqv) == 1
+        await tqv.write_byte_reg(MmReg.ROW_POP, 0)
+        rows += 1
+    assert rows == 3
+    assert await tqv.read_word_reg(MmReg.STATUS) == StatusCode.READY
+
+    # test operands can span fifo entries
+    await tqv.write_hword_reg(MmReg.PROGRAM_CODE, (0x80 << 8) | StandardOpcode.DwLnsAdvancePc)
+    await tqv.write_hword_reg(MmReg.PROGRAM_CODE, (StandardOpcode.DwLnsCopy << 8) | 0x01)
+    assert await wait_for_status_code(dut, tqv, StatusCode.EMIT_ROW, 10)
+    assert await tqv.read_word_reg(MmReg.AM_ADDRESS) == 0x80
+    await tqv.write_byte_reg(MmReg.STATUS, 0)
+
+    # test writing the program header empties the fifo
+    await stall_on_full_row_queue(dut, tqv)
+    await tqv.write_byte_reg(MmReg.PROGRAM_CODE, StandardOpcode.DwLnsCopy)
+    await tqv.write_byte_reg(MmReg.PROGRAM_CODE, StandardOpcode.DwLnsCopy)
+    assert await tqv.read_word_reg(MmReg.CODE_FIFO) == 0x22
+    await tqv.write_word_reg(MmReg.PROGRAM_HEADER, 0x0D010000)
+    assert await tqv.read_word_reg(MmReg.CODE_FIFO) == 0x04
+    assert await tqv.read_word_reg(MmReg.STATUS)    == StatusCode.READY
+
+    # test writing status after an illegal instruction empties the fifo
+    await tqv.write_word_reg(MmReg.PROGRAM_HEADER, 0x0F010000)
+    await tqv.write_byte_reg(MmReg.PROGRAM_CODE, 0x0E)
+    assert await wait_for_status_code(dut, tqv, StatusCode.ILLEGAL, 10)
+    await tqv.write_byte_reg(MmReg.PROGRAM_CODE, StandardOpcode.DwLnsCopy)
+    assert await tqv.read_word_reg(MmReg.CODE_FIFO) == 0x13
+    await tqv.write_byte_reg(MmReg.STATUS, 0)
+    assert await tqv.read_word_reg(MmReg.CODE_FIFO) == 0x04
+    assert await tqv.read_word_reg(MmReg.STATUS)    == StatusCode.READY
+
+@cocotb.test()
+async def test_row_queue(dut):
+    clock = Clock(dut.clk, 100, units="ns")
+    cocotb.start_soon(clock.start())
+
+    tqv = TinyQV(dut, PERIPHERAL_NUM)
+    await tqv.reset()
+
+    # test execution continues past emitted rows until the row queue is full
+    await tqv.write_word_reg(MmReg.PROGRAM_CODE, (StandardOpcode.DwLnsSetFile << 24) | (StandardOpcode.DwLnsCopy << 16) | (0x02 << 8) | StandardOpcode.DwLnsSetFile)
+    await tqv.write_word_reg(MmReg.PROGRAM_CODE, (0x04 << 24) | (StandardOpcode.DwLnsSetFile << 16) | (StandardOpcode.DwLnsCopy << 8) | 0x03)
+    await tqv.write_byte_reg(MmReg.PROGRAM_CODE, StandardOpcode.DwLnsCopy)
+    assert await wait_for_status_code(dut, tqv, StatusCode.EMIT_ROW, 10)
+    assert await tqv.read_word_reg(MmReg.STATUS)    == status_with_rows(StatusCode.EMIT_ROW, 2)
+    assert await tqv.read_word_reg(MmReg.CODE_FIFO) == 0x04
+
+    # test rows are read from the head of the queue and popped in order
+    assert await read_am_file(tqv) == 2
+    await tqv.write_byte_reg(MmReg.ROW_POP, 0)
+    assert await tqv.read_word_reg(MmReg.STATUS) == status_with_rows(StatusCode.EMIT_ROW, 2)
+    assert await read_am_file(tqv) == 3
+    await tqv.write_hword_reg(MmReg.ROW_POP, 0)
+    assert await tqv.read_word_reg(MmReg.STATUS) == status_with_rows(StatusCode.EMIT_ROW, 1)
+    assert await read_am_file(tqv) == 4
+    await tqv.write_word_reg(MmReg.STATUS, 0)
+    assert await tqv.read_word_reg(MmReg.STATUS) == StatusCode.READY
+
+    # test the live state is read once the queue is empty
+    assert await read_am_file(tqv) == 4
+
+    # test popping an empty queue does nothing, and reads of row pop return 0
+    await tqv.write_word_reg(MmReg.ROW_POP, 0)
+    assert await tqv.read_word_reg(MmReg.STATUS)  == StatusCode.READY
+    assert await tqv.read_word_reg(MmReg.ROW_POP) == 0x0
+
+    # test the state is reset after an end sequence row is queued
+    await tqv.write_word_reg(MmReg.PROGRAM_CODE, (StandardOpcode.DwLnsCopy << 24) | (ExtendedOpcode.DwLneEndSequence << 16) | (0x01 << 8) | ExtendedOpcode.START)
+    assert await wait_for_status_code(dut, tqv, StatusCode.EMIT_ROW, 10)
+    assert await tqv.read_word_reg(MmReg.STATUS) == status_with_rows(StatusCode.EMIT_ROW, 2)
+    assert await read_am_end_sequence(tqv) == 1
+    assert await read_am_file(tqv)         == 4
+    await tqv.write_byte_reg(MmReg.ROW_POP, 0)
+    assert await read_am_end_sequence(tqv) == 0
+    assert await read_am_file(tqv)         == 1
+    await tqv.write_byte_reg(MmReg.ROW_POP, 0)
+    assert await tqv.read_word_reg(MmReg.STATUS) == StatusCode.READY
+
+    # test rows queued before an illegal instruction are reported first
+    await tqv.write_word_reg(MmReg.PROGRAM_HEADER, 0x0F010000)
+    await tqv.write_hword_reg(MmReg.PROGRAM_CODE, (0x0E << 8) | StandardOpcode.DwLnsCopy)
+    assert await wait_for_status_code(dut, tqv, StatusCode.EMIT_ROW, 10)
+    await tqv.write_byte_reg(MmReg.STATUS, 0)
+    assert await read_status_code(tqv) == StatusCode.ILLEGAL
+    await tqv.write_byte_reg(MmReg.STATUS, 0)
+    assert await tqv.read_word_reg(MmReg.STATUS) == StatusCode.READY
+
+    # test writing the program header empties the queue
+    await stall_on_full_row_queue(dut, tqv)
+    await tqv.write_word_reg(MmReg.PROGRAM_HEADER, 0x0D010000)
+    assert await tqv.read_word_reg(MmReg.STATUS) == StatusCode.READY
+
+@cocotb.test()
+async def test_row_filter(dut):
+    clock = Clock(dut.clk, 100, units="ns")
+    cocotb.start_soon(clock.start())
+
+    tqv = TinyQV(dut, PERIPHERAL_NUM)
+    await tqv.reset()
+
+    # test filter registers only keep their implemented bits, and support partial writes
+    await tqv.write_word_reg(MmReg.FILTER_LO, 0xFFFFFFFF)
+    assert await tqv.read_word_reg(MmReg.FILTER_LO) == 0x0FFFFFFF
+    await tqv.write_word_reg(MmReg.FILTER_CTRL, 0xFFFFFFFF)
+    assert await tqv.read_word_reg(MmReg.FILTER_CTRL) == 0x7
+    await tqv.write_byte_reg(MmReg.FILTER_HI + 3, 0xAB)
+    assert await tqv.read_word_reg(MmReg.FILTER_HI) == 0x0B000000
+    await tqv.write_hword_reg(MmReg.FILTER_HI, 0x1234)
+    assert await tqv.read_word_reg(MmReg.FILTER_HI) == 0x0B001234
+
+    # rows at 0x0 (file 1), 0x10 (file 2), 0x20 (file 3), and an end sequence at 0x30
+    sequence = [
+        (0x04 << 24) | (0x10 << 16) | (StandardOpcode.DwLnsAdvancePc << 8) | StandardOpcode.DwLnsCopy,
+        (0x10 << 24) | (StandardOpcode.DwLnsAdvancePc << 16) | (StandardOpcode.DwLnsCopy << 8) | 0x02,
+        (StandardOpcode.DwLnsAdvancePc << 24) | (StandardOpcode.DwLnsCopy << 16) | (0x03 << 8) | StandardOpcode.DwLnsSetFile,
+        (0x01 << 24) | (ExtendedOpcode.DwLneEndSequence << 16) | (ExtendedOpcode.START << 8) | 0x10,
+    ]
+
+    # test only the row covering the start of the address window is reported
+    await tqv.write_word_reg(MmReg.FILTER_LO, 0x18)
+    await tqv.write_word_reg(MmReg.FILTER_HI, 0x19)
+    await tqv.write_word_reg(MmReg.FILTER_CTRL, FilterCtrl.ADDRESS)
+    for code in sequence:
+        await tqv.write_word_reg(MmReg.PROGRAM_CODE, code)
+    await ClockCycles(dut.clk, 100)
+    assert await tqv.read_word_reg(MmReg.STATUS)     == status_with_rows(StatusCode.EMIT_ROW, 1)
+    assert await tqv.read_word_reg(MmReg.AM_ADDRESS) == 0x10
+    assert await read_am_file(tqv)                   == 2
+    await tqv.write_byte_reg(MmReg.ROW_POP, 0)
+    assert await tqv.read_word_reg(MmReg.STATUS) == StatusCode.READY
+
+    # test rows in the window and end sequence rows are reported
+    await tqv.write_word_reg(MmReg.FILTER_LO, 0x10)
+    await tqv.write_word_reg(MmReg.FILTER_HI, 0x20)
+    await tqv.write_word_reg(MmReg.FILTER_CTRL, FilterCtrl.ADDRESS | FilterCtrl.END_SEQUENCE)
+    for code in sequence:
+        await tqv.write_word_reg(MmReg.PROGRAM_CODE, code)
+    await ClockCycles(dut.clk, 100)
+    assert await tqv.read_word_reg(MmReg.STATUS)     == status_with_rows(StatusCode.EMIT_ROW, 2)
+    assert await tqv.read_word_reg(MmReg.AM_ADDRESS) == 0x10
+    assert await read_am_file(tqv)                   == 2
+    await tqv.write_byte_reg(MmReg.ROW_POP, 0)
+    assert await tqv.read_word_reg(MmReg.AM_ADDRESS) == 0x30
+    assert await read_am_end_sequence(tqv)           == 1
+    await tqv.write_byte_reg(MmReg.ROW_POP, 0)
+    assert await tqv.read_word_reg(MmReg.STATUS) == StatusCode.READY
+
+    # test a window past the end of the sequence reports nothing
+    await tqv.write_word_reg(MmReg.FILTER_LO, 0x40)
+    await tqv.write_word_reg(MmReg.FILTER_HI, 0x50)
+    await tqv.write_word_reg(MmReg.FILTER_CTRL, FilterCtrl.ADDRESS)
+    for code in sequence:
+        await tqv.write_word_reg(MmReg.PROGRAM_CODE, code)
+    await ClockCycles(dut.clk, 100)
+    assert await tqv.read_word_reg(MmReg.STATUS) == StatusCode.READY
+
+    # test rows that are not statements are dropped, except for end sequence rows
+    await tqv.write_word_reg(MmReg.FILTER_CTRL, FilterCtrl.IS_STMT)
+    await tqv.write_word_reg(MmReg.PROGRAM_CODE, (0x02 << 24) | (StandardOpcode.DwLnsSetFile << 16) | (StandardOpcode.DwLnsNegateStmt << 8) | StandardOpcode.DwLnsCopy)
+    await tqv.write_word_reg(MmReg.PROGRAM_CODE, (0x01 << 24) | (ExtendedOpcode.DwLneEndSequence << 16) | (ExtendedOpcode.START << 8) | StandardOpcode.DwLnsCopy)
+    await ClockCycles(dut.clk, 100)
+    assert await tqv.read_word_reg(MmReg.STATUS) == status_with_rows(StatusCode.EMIT_ROW, 2)
+    assert await read_am_file(tqv)               == 2
+    await tqv.write_byte_reg(MmReg.ROW_POP, 0)
+    assert await read_am_end_sequence(tqv) == 1
+    await tqv.write_byte_reg(MmReg.ROW_POP, 0)
+
+    # test clearing the filter reports every row again
+    await tqv.write_word_reg(MmReg.FILTER_CTRL, 0)
+    await tqv.write_hword_reg(MmReg.PROGRAM_CODE, (StandardOpcode.DwLnsCopy << 8) | StandardOpcode.DwLnsCopy)
+    await ClockCycles(dut.clk, 100)
+    assert await tqv.read_word_reg(MmReg.STATUS) == status_with_rows(StatusCode.EMIT_ROW, 2)
+
+@cocotb.test()
+async def test_row_delta(dut):
+    clock = Clock(dut.clk, 100, units="ns")
+    cocotb.start_soon(clock.start())
+
+    tqv = TinyQV(dut, PERIPHERAL_NUM)
+    await tqv.reset()
+
+    # test reading an empty row queue returns 0
+    assert await tqv.read_word_reg(MmReg.ROW_DELTA) == 0x0
+
+    # test the first row is relative to the initial state, and reading it pops it
+    await tqv.write_byte_reg(MmReg.PROGRAM_CODE, StandardOpcode.DwLnsCopy)
+    assert await wait_for_status_code(dut, tqv, StatusCode.EMIT_ROW, 10)
+    assert await tqv.read_word_reg(MmReg.ROW_DELTA) == row_delta(0, 0, 0, 0x00, 0)
+    assert await tqv.read_word_reg(MmReg.STATUS)    == StatusCode.READY
+
+    # test address and line deltas, and the column
+    await tqv.write_hword_reg(MmReg.PROGRAM_CODE, (0x10 << 8) | StandardOpcode.DwLnsAdvancePc)
+    await tqv.write_hword_reg(MmReg.PROGRAM_CODE, (0x05 << 8) | StandardOpcode.DwLnsAdvanceLine)
+    await tqv.write_hword_reg(MmReg.PROGRAM_CODE, (0x03 << 8) | StandardOpcode.DwLnsSetColumn)
+    await tqv.write_byte_reg(MmReg.PROGRAM_CODE, StandardOpcode.DwLnsCopy)
+    assert await wait_for_status_code(dut, tqv, StatusCode.EMIT_ROW, 10)
+    assert await tqv.read_word_reg(MmReg.ROW_DELTA) == row_delta(0, 0, 3, 0x10, 5)
+
+    # test negative line deltas and flags
+    await tqv.write_hword_reg(MmReg.PROGRAM_CODE, (0x7D << 8) | StandardOpcode.DwLnsAdvanceLine)
+    await tqv.write_hword_reg(MmReg.PROGRAM_CODE, (StandardOpcode.DwLnsCopy << 8) | StandardOpcode.DwLnsNegateStmt)
+    assert await wait_for_status_code(dut, tqv, StatusCode.EMIT_ROW, 10)
+    assert await tqv.read_word_reg(MmReg.ROW_DELTA) == row_delta(0, 0x1, 3, 0x00, -3)
+
+    # test partial reads don't pop the row
+    await tqv.write_byte_reg(MmReg.PROGRAM_CODE, StandardOpcode.DwLnsCopy)
+    assert await wait_for_status_code(dut, tqv, StatusCode.EMIT_ROW, 10)
+    assert await tqv.read_hword_reg(MmReg.ROW_DELTA + 2) == row_delta(0, 0x1, 3, 0x00, 0) >> 16
+    assert await tqv.read_byte_reg(MmReg.ROW_DELTA)      == 0x00
+    assert await tqv.read_word_reg(MmReg.STATUS)         == status_with_rows(StatusCode.EMIT_ROW, 1)
+    assert await tqv.read_word_reg(MmReg.ROW_DELTA)      == row_delta(0, 0x1, 3, 0x00, 0)
+
+    # test a change of file escapes, and reading the escape doesn't pop the row
+    await tqv.write_hword_reg(MmReg.PROGRAM_CODE, (0x02 << 8) | StandardOpcode.DwLnsSetFile)
+    await tqv.write_byte_reg(MmReg.PROGRAM_CODE, StandardOpcode.DwLnsCopy)
+    assert await wait_for_status_code(dut, tqv, StatusCode.EMIT_ROW, 10)
+    assert await tqv.read_word_reg(MmReg.ROW_DELTA) == row_delta(1, 0x1, 3, 0x00, 0)
+    assert await tqv.read_word_reg(MmReg.STATUS)    == status_with_rows(StatusCode.EMIT_ROW, 1)
+    assert await read_am_file(tqv)                  == 2
+    await tqv.write_byte_reg(MmReg.ROW_POP, 0)
+
+    # test rows after an escape are relative to the escaped row
+    await tqv.write_byte_reg(MmReg.PROGRAM_CODE, StandardOpcode.DwLnsCopy)
+    assert await wait_for_status_code(dut, tqv, StatusCode.EMIT_ROW, 10)
+    assert await tqv.read_word_reg(MmReg.ROW_DELTA) == row_delta(0, 0x1, 3, 0x00, 0)
+
+    # test an address delta too large to pack escapes
+    await tqv.write_word_reg(MmReg.PROGRAM_CODE, (StandardOpcode.DwLnsCopy << 24) | (0x02 << 16) | (0x80 << 8) | StandardOpcode.DwLnsAdvancePc)
+    assert await wait_for_status_code(dut, tqv, StatusCode.EMIT_ROW, 10)
+    assert (await tqv.read_word_reg(MmReg.ROW_DELTA) >> 30) == 0x3
+    await tqv.write_byte_reg(MmReg.ROW_POP, 0)
+
+    # test a line delta too large to pack escapes
+    await tqv.write_word_reg(MmReg.PROGRAM_CODE, (StandardOpcode.DwLnsCopy << 24) | (0x00 << 16) | (0xC0 << 8) | StandardOpcode.DwLnsAdvanceLine)
+    assert await wait_for_status_code(dut, tqv, StatusCode.EMIT_ROW, 10)
+    assert (await tqv.read_word_reg(MmReg.ROW_DELTA) >> 30) == 0x3
+    await tqv.write_byte_reg(MmReg.ROW_POP, 0)
+
+    # test a discriminator escapes
+    await tqv.write_word_reg(MmReg.PROGRAM_CODE, (0x05 << 24) | (ExtendedOpcode.DwLneSetDiscriminator << 16) | (0x02 << 8) | ExtendedOpcode.START)
+    await tqv.write_byte_reg(MmReg.PROGRAM_CODE, StandardOpcode.DwLnsCopy)
+    assert await wait_for_status_code(dut, tqv, StatusCode.EMIT_ROW, 10)
+    assert (await tqv.read_word_reg(MmReg.ROW_DELTA) >> 30) == 0x3
+    assert await read_am_discrim(tqv) == 5
+    await tqv.write_byte_reg(MmReg.ROW_POP, 0)
+
+    # test rows after an end sequence row are relative to the initial state
+    await tqv.write_word_reg(MmReg.PROGRAM_CODE, (StandardOpcode.DwLnsCopy << 24) | (ExtendedOpcode.DwLneEndSequence << 16) | (0x01 << 8) | ExtendedOpcode.START)
+    assert await wait_for_status_code(dut, tqv, StatusCode.EMIT_ROW, 10)
+    await ClockCycles(dut.clk, 10)
+    assert await tqv.read_word_reg(MmReg.ROW_DELTA) == row_delta(0, 0x5, 3, 0x00, 0)
+    assert await tqv.read_word_reg(MmReg.ROW_DELTA) == row_delta(0, 0, 0, 0x00, 0)
+    assert await tqv.read_word_reg(MmReg.STATUS)    == StatusCode.READY
+
+@cocotb.test()
+async def test_interrupt(dut):
+    clock = Clock(dut.clk, 100, units="ns")
+    cocotb.start_soon(clock.start())
+
+    tqv = TinyQV(dut, PERIPHERAL_NUM)
+    await tqv.reset()
+
+    # test the interrupt mask only keeps its implemented bits, and interrupts are off by default
+    assert not await tqv.is_interrupt_asserted()
+    await tqv.write_byte_reg(MmReg.PROGRAM_CODE, StandardOpcode.DwLnsCopy)
+    assert await wait_for_status_code(dut, tqv, StatusCode.EMIT_ROW, 10)
+    assert not await tqv.is_interrupt_asserted()
+    await tqv.write_word_reg(MmReg.INT_MASK, 0xFFFFFFFF)
+    assert await tqv.read_word_reg(MmReg.INT_MASK) == 0xF
+    assert await tqv.is_interrupt_asserted()
+    await tqv.write_word_reg(MmReg.ROW_POP, 0)
+
+    # test the interrupt is raised while rows are queued
+    await tqv.write_word_reg(MmReg.INT_MASK, IntMask.EMIT_ROW)
+    await ClockCycles(dut.clk, 10)
+    assert not await tqv.is_interrupt_asserted()
+    await tqv.write_byte_reg(MmReg.PROGRAM_CODE, StandardOpcode.DwLnsCopy)
+    assert await wait_for_status_code(dut, tqv, StatusCode.EMIT_ROW, 10)
+    assert await tqv.is_interrupt_asserted()
+    await tqv.write_word_reg(MmReg.ROW_POP, 0)
+    await ClockCycles(dut.clk, 10)
+    assert not await tqv.is_interrupt_asserted()
+
+    # test the interrupt is raised on an illegal instruction, until it is cleared
+    await tqv.write_word_reg(MmReg.INT_MASK, IntMask.ILLEGAL)
+    await tqv.write_word_reg(MmReg.PROGRAM_HEADER, 0x0F010000)
+    await tqv.write_byte_reg(MmReg.PROGRAM_CODE, 0x0E)
+    assert await wait_for_status_code(dut, tqv, StatusCode.ILLEGAL, 10)
+    assert await tqv.is_interrupt_asserted()
+    await tqv.write_word_reg(MmReg.STATUS, 0)
+    await ClockCycles(dut.clk, 10)
+    assert not await tqv.is_interrupt_asserted()
+
+    # test the interrupt is raised once the peripheral runs out of code, until acknowledged, and
+    # that writes to the interrupt mask don't acknowledge it
+    await tqv.write_word_reg(MmReg.INT_MASK, IntMask.READY)
+    await tqv.write_word_reg(MmReg.PROGRAM_HEADER, 0x0D010000)
+    await ClockCycles(dut.clk, 10)
+    assert not await tqv.is_interrupt_asserted()
+    await tqv.write_byte_reg(MmReg.PROGRAM_CODE, StandardOpcode.DwLnsSetBasicBlock)
+    await ClockCycles(dut.clk, 10)
+    assert await tqv.read_word_reg(MmReg.STATUS) == StatusCode.READY
+    assert await tqv.is_interrupt_asserted()
+    await tqv.write_word_reg(MmReg.INT_MASK, IntMask.READY | IntMask.EMIT_ROW)
+    await ClockCycles(dut.clk, 10)
+    assert await tqv.is_interrupt_asserted()
+    await tqv.write_word_reg(MmReg.INT_MASK, IntMask.EMIT_ROW)
+    await ClockCycles(dut.clk, 10)
+    assert not await tqv.is_interrupt_asserted()
+    await tqv.write_word_reg(MmReg.INT_MASK, IntMask.READY)
+    await ClockCycles(dut.clk, 10)
+    assert await tqv.is_interrupt_asserted()
+    await tqv.write_word_reg(MmReg.PROGRAM_HEADER, 0x0D010000)
+    await ClockCycles(dut.clk, 10)
+    assert not await tqv.is_interrupt_asserted()
+
+    # test ready is also raised after an instruction split across writes
+    await tqv.write_byte_reg(MmReg.PROGRAM_CODE, StandardOpcode.DwLnsAdvancePc)
+    await ClockCycles(dut.clk, 10)
+    assert await tqv.is_interrupt_asserted()
+    await tqv.write_word_reg(MmReg.PROGRAM_HEADER, 0x0D010000)
+    await ClockCycles(dut.clk, 10)
+    assert not await tqv.is_interrupt_asserted()
+
+    # test the interrupt is raised while at least 2 program code FIFO entries are free, so while
+    # execution is blocked on a full row queue, it is only raised once there is room for a burst
+    await tqv.write_word_reg(MmReg.INT_MASK, IntMask.CODE)
+    assert await tqv.is_interrupt_asserted()
+    await tqv.write_byte_reg(MmReg.PROGRAM_CODE, StandardOpcode.DwLnsCopy)
+    assert await wait_for_status_code(dut, tqv, StatusCode.EMIT_ROW, 10)
+    for i in range(5):
+        await tqv.write_byte_reg(MmReg.PROGRAM_CODE, StandardOpcode.DwLnsCopy)
+    await ClockCycles(dut.clk, 10)
+    assert await tqv.read_word_reg(MmReg.CODE_FIFO) == 0x31
+    assert not await tqv.is_interrupt_asserted()
+    await tqv.write_word_reg(MmReg.ROW_POP, 0)
+    await ClockCycles(dut.clk, 10)
+    assert await tqv.read_word_reg(MmReg.CODE_FIFO) == 0x22
+    assert await tqv.is_interrupt_asserted()
+    await tqv.write_word_reg(MmReg.INT_MASK, 0)
+    await ClockCycles(dut.clk, 10)
+    assert not await tqv.is_interrupt_asserted()
+    await tqv.write_word_reg(MmReg.PROGRAM_HEADER, 0x0D010000)
 
 @cocotb.test()
 async def test_dw_lns_copy(dut):
@@ -575,6 +998,13 @@ async def test_dw_lns_advance_line(dut):
     assert await read_am_line(tqv) == 0x2
     await tqv.write_byte_reg(MmReg.STATUS, 1)
 
+    # test advance line with four byte negative operand split across program code writes
+    await tqv.write_hword_reg(MmReg.PROGRAM_CODE, (0xFF << 8) | StandardOpcode.DwLnsAdvanceLine)
+    await tqv.write_word_reg(MmReg.PROGRAM_CODE, (StandardOpcode.DwLnsCopy << 24) | 0x7FFFFF)
+    assert await wait_for_status_code(dut, tqv, StatusCode.EMIT_ROW, 10)
+    assert await read_am_line(tqv) == 0x1
+    await tqv.write_byte_reg(MmReg.STATUS, 1)
+
 @cocotb.test()
 async def test_dw_lns_set_file(dut):
     clock = Clock(dut.clk, 100, units="ns")
@@ -888,6 +1318,15 @@ async def test_dw_lne_set_address(dut):
     assert await tqv.read_word_reg(MmReg.AM_ADDRESS) == 0xABBCCDD
     await tqv.write_byte_reg(MmReg.STATUS, 1)
 
+    # test set address with the operand split across program code writes
+    await tqv.write_hword_reg(MmReg.PROGRAM_CODE, (0x05 << 8) | ExtendedOpcode.START)
+    await tqv.write_hword_reg(MmReg.PROGRAM_CODE, (0x44 << 8) | ExtendedOpcode.DwLneSetAddress)
+    await tqv.write_byte_reg(MmReg.PROGRAM_CODE, 0x33)
+    await tqv.write_word_reg(MmReg.PROGRAM_CODE, (StandardOpcode.DwLnsCopy << 16) | 0x0122)
+    assert await wait_for_status_code(dut, tqv, StatusCode.EMIT_ROW, 10)
+    assert await tqv.read_word_reg(MmReg.AM_ADDRESS) == 0x1223344
+    await tqv.write_byte_reg(MmReg.STATUS, 1)
+
 @cocotb.test()
 async def test_dw_lne_set_discriminator(dut):
     clock = Clock(dut.clk, 100, units="ns")
@@ -933,6 +1372,12 @@ async def test_dw_special_opcodes(dut):
                 for opcode in opcodes:
                     await run_special_opcode_test(dut, tqv, opcode_base, line_base, line_range, opcode)
 
+    # test line_range values around the multiples used by the divider, which divides two bits of the
+    # adjusted opcode at a time, and around the line ranges at which it skips its leading steps
+    for line_range in [2, 3, 4, 5, 14, 15, 16, 17, 63, 64, 85, 86, 127, 128, 254, 255]:
+        for opcode in [0, 1, 2, 3, 4, 63, 64, 127, 128, 170, 171, 254, 255]:
+            await run_special_opcode_test(dut, tqv, 0, 0, line_range, opcode)
+
     # test that basic_block, prologue_end, epilogue_begin, and discriminator are reset by special opcode
     await tqv.write_word_reg(MmReg.PROGRAM_HEADER, 0x0D0A0200)
     await tqv.write_word_reg(MmReg.PROGRAM_CODE, (ExtendedOpcode.START << 24) | (StandardOpcode.DwLnsSetEpilogueBegin << 16) | (StandardOpcode.DwLnsSetPrologueEnd << 8) | StandardOpcode.DwLnsSetBasicBlock)
@@ -995,7 +1440,7 @@ async def test_illegal_instruction(dut):
 async def wait_for_status_code(dut, tqv, status_code, timeout):
     while timeout > 0:
         await ClockCycles(dut.clk, 1)
-        current_status_code = await tqv.read_byte_reg(MmReg.STATUS)
+        current_status_code = await read_status_code(tqv)
         assert current_status_code != StatusCode.READY
         if current_status_code == status_code:
             return True
@@ -1003,6 +1448,17 @@ async def wait_for_status_code(dut, tqv, status_code, timeout):
             timeout -= 1
     return False
 
+async def read_status_code(tqv):
+    status = await tqv.read_byte_reg(MmReg.STATUS)
+    return status & 0x3
+
+async def stall_on_full_row_queue(dut, tqv):
+    await tqv.write_hword_reg(MmReg.PROGRAM_CODE, (StandardOpcode.DwLnsCopy << 8) | StandardOpcode.DwLnsCopy)
+    await tqv.write_byte_reg(MmReg.PROGRAM_CODE, StandardOpcode.DwLnsCopy)
+    assert await wait_for_status_code(dut, tqv, StatusCode.EMIT_ROW, 10)
+    assert await tqv.read_word_reg(MmReg.STATUS)    == status_with_rows(StatusCode.EMIT_ROW, 2)
+    assert await tqv.read_word_reg(MmReg.CODE_FIFO) == 0x04
+
 async def read_am_line(tqv):
     line_col_flags = await tqv.read_word_reg(MmReg.AM_LINE_COL_FLAGS)
     return line_col_flags & 0xFFFF
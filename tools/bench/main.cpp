@@ -0,0 +1,592 @@
+#include <charconv>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "../../ris-test/sim.h"
+#include "../../ris-test/testgen.h"
+#include "../common/leb128.h"
+#include "../common/line_decoder.h"
+#include "../show-asm/elf_file.h"
+
+// Program header used for the opcode class microbenchmarks. These are the values emitted by gcc
+// for RISC-V: default_is_stmt = 1, line_base = -5, line_range = 14, opcode_base = 13.
+#define BENCH_PROGRAM_HEADER 0x0D0EFB01
+
+#define CLASS_INSTRUCTIONS 256
+
+#define SOFTWARE_REPEATS 16
+
+#define LEB_REPEATS 64
+
+// Opcode base used by the line_range sweep, with every other opcode being a special opcode.
+#define SWEEP_OPCODE_BASE 0x0D
+
+enum OpcodeClass
+{
+	OPCODE_CLASS_SPECIAL,
+	OPCODE_CLASS_STANDARD_LEB,
+	OPCODE_CLASS_EXTENDED,
+	OPCODE_CLASS_FIXED_ADVANCE_PC,
+	OPCODE_CLASS_OTHER,
+	OPCODE_CLASS_COUNT
+};
+
+static char const *opcode_class_names[OPCODE_CLASS_COUNT] = {
+	"special",
+	"standard_leb",
+	"extended",
+	"fixed_advance_pc",
+	"other",
+};
+
+struct BenchResult
+{
+	std::string name;
+	uint64_t bytes;
+	uint64_t rows;
+	uint64_t cycles;
+	uint64_t drain_cycles;
+	uint64_t bus_transactions;
+	uint64_t status_reads;
+	double software_ns;
+	bool completed;
+	uint64_t instructions[OPCODE_CLASS_COUNT];
+};
+
+struct Config
+{
+	uint32_t seed;
+	uint32_t num_random_tests;
+	WritePacing write_pacing;
+	uint32_t bus_latency;
+	RowDrain row_drain;
+	StatusWait status_wait;
+	bool leb;
+	bool line_range_sweep;
+	std::vector<char const *> elf_files;
+};
+
+[[noreturn]] static void print_usage() {
+	std::cerr << "usage: bench [--seed <seed>] [--random <num-tests>] [--pacing fixed|adaptive]\n"
+	             "             [--bus-latency <cycles>] [--drain registers|delta]\n"
+	             "             [--wait poll|interrupt] [--leb] [--line-range-sweep] [elf-files...]\n";
+	exit(-1);
+}
+
+// Parse a whole argument as an unsigned number, showing the usage if it isn't one.
+static uint32_t parse_number(char const *argument) {
+	uint32_t value;
+	char const *const end = argument + strlen(argument);
+	std::from_chars_result const result = std::from_chars(argument, end, value);
+	if (result.ec != std::errc() || result.ptr != end) {
+		print_usage();
+	}
+	return value;
+}
+
+// Write value as a quoted JSON string, escaping quotes, backslashes, and control characters.
+static void print_json_string(std::string const &value) {
+	std::cout << '"';
+	for (char const c : value) {
+		if (c == '"' || c == '\\') {
+			std::cout << '\\' << c;
+		} else if ((unsigned char)c < 0x20) {
+			char escape[7];
+			snprintf(escape, sizeof(escape), "\\u%04x", c);
+			std::cout << escape;
+		} else {
+			std::cout << c;
+		}
+	}
+	std::cout << '"';
+}
+
+static Config parse_arguments(int argc, char **argv) {
+	Config config = {
+		1, 64, WRITE_PACING_FIXED, FIXED_WRITE_PACING_CYCLES, ROW_DRAIN_REGISTERS, STATUS_WAIT_POLL,
+		false, false, { }
+	};
+
+	for (int i = 1; i < argc; ++i) {
+		if (strcmp(argv[i], "--seed") == 0 && i + 1 < argc) {
+			config.seed = parse_number(argv[++i]);
+		} else if (strcmp(argv[i], "--random") == 0 && i + 1 < argc) {
+			config.num_random_tests = parse_number(argv[++i]);
+		} else if (strcmp(argv[i], "--pacing") == 0 && i + 1 < argc) {
+			++i;
+			if (strcmp(argv[i], "fixed") == 0) {
+				config.write_pacing = WRITE_PACING_FIXED;
+			} else if (strcmp(argv[i], "adaptive") == 0) {
+				config.write_pacing = WRITE_PACING_ADAPTIVE;
+			} else {
+				print_usage();
+			}
+		} else if (strcmp(argv[i], "--bus-latency") == 0 && i + 1 < argc) {
+			config.bus_latency = parse_number(argv[++i]);
+		} else if (strcmp(argv[i], "--drain") == 0 && i + 1 < argc) {
+			++i;
+			if (strcmp(argv[i], "registers") == 0) {
+				config.row_drain = ROW_DRAIN_REGISTERS;
+			} else if (strcmp(argv[i], "delta") == 0) {
+				config.row_drain = ROW_DRAIN_DELTA;
+			} else {
+				print_usage();
+			}
+		} else if (strcmp(argv[i], "--wait") == 0 && i + 1 < argc) {
+			++i;
+			if (strcmp(argv[i], "poll") == 0) {
+				config.status_wait = STATUS_WAIT_POLL;
+			} else if (strcmp(argv[i], "interrupt") == 0) {
+				config.status_wait = STATUS_WAIT_INTERRUPT;
+			} else {
+				print_usage();
+			}
+		} else if (strcmp(argv[i], "--leb") == 0) {
+			config.leb = true;
+		} else if (strcmp(argv[i], "--line-range-sweep") == 0) {
+			config.line_range_sweep = true;
+		} else if (argv[i][0] == '-') {
+			print_usage();
+		} else {
+			config.elf_files.push_back(argv[i]);
+		}
+	}
+
+	return config;
+}
+
+// Skip a LEB128 operand, appending its bytes to leb_operands if it is not null.
+static size_t skip_leb(std::vector<uint8_t> const &program, size_t ip, std::vector<uint8_t> *leb_operands) {
+	size_t const start = ip;
+	while (ip < program.size() && (program[ip] & 0x80) != 0) {
+		ip += 1;
+	}
+	if (leb_operands && ip < program.size()) {
+		leb_operands->insert(leb_operands->end(), program.begin() + start, program.begin() + ip + 1);
+	}
+	return ip + 1;
+}
+
+// Walk the program the same way the accelerator decodes it, counting instructions of each class and
+// optionally collecting the LEB128 operands. Decoding stops at the first illegal instruction, just
+// like the hardware.
+static void classify_instructions(Test const *test, uint64_t *instructions, std::vector<uint8_t> *leb_operands) {
+	uint8_t const opcode_base = test->program_header >> 24;
+	std::vector<uint8_t> const &program = test->program;
+
+	size_t ip = 0;
+	while (ip < program.size()) {
+		uint8_t const opcode = program[ip++];
+		if (opcode >= opcode_base) {
+			instructions[OPCODE_CLASS_SPECIAL] += 1;
+		} else if (opcode == EXTENDED_OPCODE_START) {
+			instructions[OPCODE_CLASS_EXTENDED] += 1;
+			ip = skip_leb(program, ip, leb_operands);
+			if (ip >= program.size()) {
+				break;
+			}
+			uint8_t const extended_opcode = program[ip++];
+			if (extended_opcode == DW_LNE_SETADDRESS) {
+				ip += 4;
+			} else if (extended_opcode == DW_LNE_SETDISCRIMINATOR) {
+				ip = skip_leb(program, ip, leb_operands);
+			} else if (extended_opcode != DW_LNE_ENDSEQUENCE) {
+				break;
+			}
+		} else if (opcode == DW_LNS_FIXEDADVANCEPC) {
+			instructions[OPCODE_CLASS_FIXED_ADVANCE_PC] += 1;
+			ip += 2;
+		} else if (opcode == DW_LNS_ADVANCEPC || opcode == DW_LNS_ADVANCELINE ||
+		           opcode == DW_LNS_SETFILE || opcode == DW_LNS_SETCOLUMN || opcode == DW_LNS_SETISA) {
+			instructions[OPCODE_CLASS_STANDARD_LEB] += 1;
+			ip = skip_leb(program, ip, leb_operands);
+		} else if (opcode > DW_LNS_SETISA) {
+			break;
+		} else {
+			instructions[OPCODE_CLASS_OTHER] += 1;
+		}
+	}
+}
+
+// Average time taken by the software decoder over SOFTWARE_REPEATS runs, as the baseline the
+// accelerator has to beat.
+static double time_software_decoder(Test const *test) {
+	LineDecoder const decoder { test->program_header };
+	LineTable line_table;
+	line_table.reserve(test->program.size());
+
+	auto const start = std::chrono::steady_clock::now();
+	for (int i = 0; i < SOFTWARE_REPEATS; ++i) {
+		line_table.clear();
+		decoder.decode(test->program.data(), test->program.size(), line_table);
+	}
+	auto const end = std::chrono::steady_clock::now();
+
+	return std::chrono::duration<double, std::nano>(end - start).count() / SOFTWARE_REPEATS;
+}
+
+// Run a test to completion on the accelerator, draining every row the same way a driver would.
+static BenchResult run_benchmark(HardwareSim &hwsim, std::string const &name, Test *test) {
+	BenchResult result = { name, test->program.size(), 0, 0, 0, 0, 0, 0.0, false, { } };
+	classify_instructions(test, result.instructions, nullptr);
+	result.software_ns = time_software_decoder(test);
+
+	uint64_t const start_cycles           = hwsim.cycle_count();
+	uint64_t const start_bus_transactions = hwsim.bus_transaction_count();
+	uint64_t const start_status_reads     = hwsim.status_read_count();
+	hwsim.set_program(test);
+	while (hwsim.run_to_emit_row_or_illegal()) {
+		uint32_t const status = hwsim.read_dword(STATUS) & STATUS_CODE_MASK;
+		if (status != STATUS_EMIT_ROW) {
+			result.completed = status == STATUS_READY;
+			break;
+		}
+		uint64_t const drain_start_cycles = hwsim.cycle_count();
+		hwsim.drain_row();
+		result.drain_cycles += hwsim.cycle_count() - drain_start_cycles;
+		result.rows += 1;
+	}
+	result.cycles           = hwsim.cycle_count() - start_cycles;
+	result.bus_transactions = hwsim.bus_transaction_count() - start_bus_transactions;
+	result.status_reads     = hwsim.status_read_count() - start_status_reads;
+
+	return result;
+}
+
+static void push_leb(std::vector<uint8_t> &program, uint32_t value) {
+	do {
+		uint8_t byte = value & 0x7F;
+		value >>= 7;
+		if (value != 0) {
+			byte |= 0x80;
+		}
+		program.push_back(byte);
+	} while (value != 0);
+}
+
+static void push_end_sequence(std::vector<uint8_t> &program) {
+	program.push_back(EXTENDED_OPCODE_START);
+	program.push_back(0x01);
+	program.push_back(DW_LNE_ENDSEQUENCE);
+}
+
+// Build a program consisting of CLASS_INSTRUCTIONS instructions of the given class, followed by an
+// end sequence. Passing OPCODE_CLASS_COUNT builds the baseline program with only the end sequence.
+static std::unique_ptr<Test> make_class_test(OpcodeClass opcode_class) {
+	auto test = std::make_unique<Test>();
+	test->program_header = BENCH_PROGRAM_HEADER;
+	std::vector<uint8_t> &program = test->program;
+
+	for (uint32_t i = 0; opcode_class != OPCODE_CLASS_COUNT && i < CLASS_INSTRUCTIONS; ++i) {
+		switch (opcode_class) {
+			case OPCODE_CLASS_SPECIAL: {
+				program.push_back(0x0D + (i % (256 - 0x0D)));
+			} break;
+			case OPCODE_CLASS_STANDARD_LEB: {
+				static uint8_t const opcodes[] = {
+					DW_LNS_ADVANCEPC, DW_LNS_ADVANCELINE, DW_LNS_SETFILE, DW_LNS_SETCOLUMN
+				};
+				program.push_back(opcodes[i % 4]);
+				push_leb(program, (i * 37) & ((1 << (7 * (1 + i % 3))) - 1));
+			} break;
+			case OPCODE_CLASS_EXTENDED: {
+				program.push_back(EXTENDED_OPCODE_START);
+				if (i % 2 == 0) {
+					program.push_back(0x05);
+					program.push_back(DW_LNE_SETADDRESS);
+					for (uint32_t j = 0; j < 4; ++j) {
+						program.push_back(((i * 0x100) >> (8 * j)) & 0xFF);
+					}
+				} else {
+					program.push_back(0x02);
+					program.push_back(DW_LNE_SETDISCRIMINATOR);
+					push_leb(program, i & 0x7F);
+				}
+			} break;
+			case OPCODE_CLASS_FIXED_ADVANCE_PC: {
+				program.push_back(DW_LNS_FIXEDADVANCEPC);
+				program.push_back(i & 0xFF);
+				program.push_back(0x00);
+			} break;
+			default: {
+			} break;
+		}
+	}
+
+	push_end_sequence(program);
+
+	return test;
+}
+
+static void print_result(BenchResult const &result, bool last) {
+	std::cout << "    { \"name\": ";
+	print_json_string(result.name);
+	std::cout << ", \"completed\": " <<
+		(result.completed ? "true" : "false") << ", \"bytes\": " << result.bytes <<
+		", \"rows\": " << result.rows << ", \"cycles\": " << result.cycles <<
+		", \"drain_cycles\": " << result.drain_cycles <<
+		", \"cycles_per_byte\": " << (result.bytes ? (double)result.cycles / result.bytes : 0.0) <<
+		", \"cycles_per_row\": " << (result.rows ? (double)result.cycles / result.rows : 0.0) <<
+		", \"bus_transactions\": " << result.bus_transactions <<
+		", \"bus_transactions_per_byte\": " <<
+			(result.bytes ? (double)result.bus_transactions / result.bytes : 0.0) <<
+		", \"bus_transactions_per_row\": " <<
+			(result.rows ? (double)result.bus_transactions / result.rows : 0.0) <<
+		", \"status_reads\": " << result.status_reads <<
+		", \"software_ns\": " << result.software_ns <<
+		", \"instructions\": {";
+	for (int i = 0; i < OPCODE_CLASS_COUNT; ++i) {
+		std::cout << (i ? ", " : " ") << '"' << opcode_class_names[i] << "\": " << result.instructions[i];
+	}
+	std::cout << " } }" << (last ? "" : ",") << '\n';
+}
+
+static bool load_elf_test(char const *elf_file_name, Test &test) {
+	ElfFile elf_file { elf_file_name };
+	if (!elf_file.valid()) {
+		return false;
+	}
+	Span const program_code = elf_file.program_code();
+	test.program_header = elf_file.program_header();
+	test.program.assign(program_code.data, program_code.data + program_code.size);
+	return true;
+}
+
+// The byte-at-a-time loop the reference model used before the shared LEB128 decoder, kept as the
+// baseline for the LEB128 benchmark.
+static size_t decode_uleb_run_legacy(uint8_t const *&cur, uint8_t const *end, uint64_t *values, size_t count) {
+	size_t decoded = 0;
+	while (decoded < count && cur < end) {
+		uint32_t result = 0;
+		uint32_t shift = 0;
+		uint8_t byte;
+		do {
+			byte = *cur++;
+			if (shift < 31) {
+				result |= (byte & 0x7F) << shift;
+				shift  += 7;
+			}
+		} while ((byte & 0x80) != 0 && cur < end);
+		values[decoded++] = result;
+	}
+	return decoded;
+}
+
+// Time each LEB128 decoder over the operands of every program in the corpus, laid end to end the
+// same way runs of operands appear in real line programs.
+static int run_leb_benchmark(Config const &config) {
+	std::vector<uint8_t> leb_operands;
+	uint64_t instructions[OPCODE_CLASS_COUNT] = { };
+
+	RandomTestGenerator test_generator(config.num_random_tests, config.seed);
+	while (test_generator.has_tests()) {
+		std::unique_ptr<Test> test = test_generator.next_test();
+		classify_instructions(test.get(), instructions, &leb_operands);
+	}
+	for (char const *elf_file_name : config.elf_files) {
+		Test test;
+		if (!load_elf_test(elf_file_name, test)) {
+			return -1;
+		}
+		classify_instructions(&test, instructions, &leb_operands);
+	}
+
+	uint8_t const *const begin = leb_operands.data();
+	uint8_t const *const end   = begin + leb_operands.size();
+	std::vector<uint64_t> values(leb_operands.size());
+
+	std::cout << "{\n";
+	std::cout << "  \"seed\": " << config.seed << ",\n";
+	std::cout << "  \"bytes\": " << leb_operands.size() << ",\n";
+	std::cout << "  \"decoders\": {\n";
+	bool first = true;
+	for (int i = -1; i < LEB_DECODER_COUNT; ++i) {
+		if (i >= 0 && !leb_decoder_supported((LebDecoder)i)) {
+			continue;
+		}
+		size_t num_values = 0;
+		auto const start = std::chrono::steady_clock::now();
+		for (int repeat = 0; repeat < LEB_REPEATS; ++repeat) {
+			uint8_t const *cur = begin;
+			num_values = i < 0 ?
+				decode_uleb_run_legacy(cur, end, values.data(), values.size()) :
+				decode_uleb_run((LebDecoder)i, cur, end, values.data(), values.size());
+		}
+		auto const finish = std::chrono::steady_clock::now();
+		double const ns = std::chrono::duration<double, std::nano>(finish - start).count() / LEB_REPEATS;
+		std::cout << (first ? "" : ",\n") << "    \"" << (i < 0 ? "legacy" : leb_decoder_names[i]) <<
+			"\": { \"values\": " << num_values <<
+			", \"ns_per_value\": " << (num_values ? ns / num_values : 0.0) <<
+			", \"mb_per_second\": " << (ns > 0.0 ? leb_operands.size() * 1e3 / ns : 0.0) << " }";
+		first = false;
+	}
+	std::cout << "\n  }\n";
+	std::cout << "}\n";
+
+	return 0;
+}
+
+// Build a program running every special opcode once under the given line_range, followed by an end
+// sequence. With no special opcodes, this is the baseline for that line_range.
+static std::unique_ptr<Test> make_sweep_test(uint8_t line_range, bool special_opcodes) {
+	auto test = std::make_unique<Test>();
+	test->program_header = (SWEEP_OPCODE_BASE << 24) | (line_range << 16) | 0x1;
+
+	for (uint32_t opcode = SWEEP_OPCODE_BASE; special_opcodes && opcode < 256; ++opcode) {
+		test->program.push_back(opcode);
+	}
+	push_end_sequence(test->program);
+
+	return test;
+}
+
+// Measure the cost of a special opcode for every line_range, since the time taken to divide the
+// adjusted opcode by line_range is the part of a special opcode that depends on the header.
+static int run_line_range_sweep(Config const &config) {
+	HardwareSim hwsim;
+	hwsim.set_write_pacing(config.write_pacing, config.bus_latency);
+	hwsim.set_row_drain(config.row_drain);
+	hwsim.set_status_wait(config.status_wait);
+
+	uint32_t const num_special_opcodes = 256 - SWEEP_OPCODE_BASE;
+
+	std::cout << "{\n";
+	std::cout << "  \"info\": " << hwsim.read_dword(INFO) << ",\n";
+	std::cout << "  \"pacing\": \"" << (config.write_pacing == WRITE_PACING_FIXED ? "fixed" : "adaptive") <<
+		"\",\n";
+	std::cout << "  \"bus_latency\": " << config.bus_latency << ",\n";
+	std::cout << "  \"drain\": \"" << (config.row_drain == ROW_DRAIN_REGISTERS ? "registers" : "delta") <<
+		"\",\n";
+	std::cout << "  \"wait\": \"" << (config.status_wait == STATUS_WAIT_POLL ? "poll" : "interrupt") <<
+		"\",\n";
+	std::cout << "  \"line_ranges\": [\n";
+	for (uint32_t line_range = 1; line_range < 256; ++line_range) {
+		std::unique_ptr<Test> baseline_test = make_sweep_test(line_range, false);
+		std::unique_ptr<Test> sweep_test    = make_sweep_test(line_range, true);
+		BenchResult const baseline = run_benchmark(hwsim, "baseline", baseline_test.get());
+		BenchResult const result   = run_benchmark(hwsim, "special", sweep_test.get());
+
+		// As for the opcode classes, differences are signed and the drain cost is reported
+		// separately. Every special opcode emits a row, so the total per special opcode is what a
+		// driver sees, and the cycles outside draining are the divider's share of it.
+		int64_t const cycles       = (int64_t)result.cycles - (int64_t)baseline.cycles;
+		int64_t const drain_cycles = (int64_t)result.drain_cycles - (int64_t)baseline.drain_cycles;
+		std::cout << "    { \"line_range\": " << line_range <<
+			", \"completed\": " << (result.completed ? "true" : "false") <<
+			", \"special_opcodes\": " << num_special_opcodes <<
+			", \"cycles\": " << cycles <<
+			", \"drain_cycles\": " << drain_cycles <<
+			", \"cycles_per_special_opcode\": " << (double)cycles / num_special_opcodes <<
+			", \"undrained_cycles_per_special_opcode\": " << (double)(cycles - drain_cycles) / num_special_opcodes <<
+			" }" << (line_range == 255 ? "" : ",") << '\n';
+	}
+	std::cout << "  ]\n";
+	std::cout << "}\n";
+
+	return 0;
+}
+
+int main(int argc, char **argv) {
+	Config config = parse_arguments(argc, argv);
+
+	if (config.leb) {
+		return run_leb_benchmark(config);
+	}
+
+	if (config.line_range_sweep) {
+		return run_line_range_sweep(config);
+	}
+
+	HardwareSim hwsim;
+	hwsim.set_write_pacing(config.write_pacing, config.bus_latency);
+	hwsim.set_row_drain(config.row_drain);
+	hwsim.set_status_wait(config.status_wait);
+
+	std::vector<BenchResult> corpus;
+
+	RandomTestGenerator test_generator(config.num_random_tests, config.seed);
+	for (uint32_t i = 0; test_generator.has_tests(); ++i) {
+		std::unique_ptr<Test> test = test_generator.next_test();
+		corpus.push_back(run_benchmark(hwsim, "random-" + std::to_string(i), test.get()));
+	}
+
+	for (char const *elf_file_name : config.elf_files) {
+		Test test;
+		if (!load_elf_test(elf_file_name, test)) {
+			return -1;
+		}
+		corpus.push_back(run_benchmark(hwsim, elf_file_name, &test));
+	}
+
+	std::unique_ptr<Test> baseline_test = make_class_test(OPCODE_CLASS_COUNT);
+	BenchResult const baseline = run_benchmark(hwsim, "baseline", baseline_test.get());
+
+	std::vector<BenchResult> classes;
+	for (int i = 0; i < OPCODE_CLASS_OTHER; ++i) {
+		std::unique_ptr<Test> class_test = make_class_test((OpcodeClass)i);
+		classes.push_back(run_benchmark(hwsim, opcode_class_names[i], class_test.get()));
+	}
+
+	BenchResult total = { "total", 0, 0, 0, 0, 0, 0, 0.0, true, { } };
+	for (BenchResult const &result : corpus) {
+		total.bytes            += result.bytes;
+		total.rows             += result.rows;
+		total.cycles           += result.cycles;
+		total.drain_cycles     += result.drain_cycles;
+		total.bus_transactions += result.bus_transactions;
+		total.status_reads     += result.status_reads;
+		total.software_ns      += result.software_ns;
+		total.completed         = total.completed && result.completed;
+		for (int i = 0; i < OPCODE_CLASS_COUNT; ++i) {
+			total.instructions[i] += result.instructions[i];
+		}
+	}
+
+	std::cout << "{\n";
+	std::cout << "  \"info\": " << hwsim.read_dword(INFO) << ",\n";
+	std::cout << "  \"seed\": " << config.seed << ",\n";
+	std::cout << "  \"pacing\": \"" << (config.write_pacing == WRITE_PACING_FIXED ? "fixed" : "adaptive") <<
+		"\",\n";
+	std::cout << "  \"bus_latency\": " << config.bus_latency << ",\n";
+	std::cout << "  \"drain\": \"" << (config.row_drain == ROW_DRAIN_REGISTERS ? "registers" : "delta") <<
+		"\",\n";
+	std::cout << "  \"wait\": \"" << (config.status_wait == STATUS_WAIT_POLL ? "poll" : "interrupt") <<
+		"\",\n";
+	std::cout << "  \"wasted_cycles\": " << hwsim.wasted_cycle_count() << ",\n";
+	std::cout << "  \"corpus\": [\n";
+	for (size_t i = 0; i < corpus.size(); ++i) {
+		print_result(corpus[i], i + 1 == corpus.size());
+	}
+	std::cout << "  ],\n";
+	std::cout << "  \"total\":\n";
+	print_result(total, false);
+	std::cout << "  \"opcode_classes\": {\n";
+	for (size_t i = 0; i < classes.size(); ++i) {
+		// Differences are signed so a class that runs faster than the baseline can't wrap. The
+		// engine keeps running while queued rows are drained, so subtracting the drain cycles
+		// leaves the part of the instructions' cost not hidden behind draining; the drain cost is
+		// reported separately.
+		int64_t const cycles = (int64_t)classes[i].cycles - (int64_t)baseline.cycles;
+		int64_t const drain_cycles = (int64_t)classes[i].drain_cycles - (int64_t)baseline.drain_cycles;
+		double const cycles_per_instruction = (double)(cycles - drain_cycles) / CLASS_INSTRUCTIONS;
+		std::cout << "    ";
+		print_json_string(classes[i].name);
+		std::cout << ": { \"instructions\": " << CLASS_INSTRUCTIONS <<
+			", \"bytes\": " << (int64_t)classes[i].bytes - (int64_t)baseline.bytes <<
+			", \"rows\": " << (int64_t)classes[i].rows - (int64_t)baseline.rows <<
+			", \"cycles\": " << cycles <<
+			", \"drain_cycles\": " << drain_cycles <<
+			", \"cycles_per_instruction\": " << cycles_per_instruction << " }" <<
+			(i + 1 == classes.size() ? "" : ",") << '\n';
+	}
+	std::cout << "  }\n";
+	std::cout << "}\n";
+
+	return 0;
+}
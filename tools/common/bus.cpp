@@ -0,0 +1,219 @@
+#include "bus.h"
+
+LineTableRow const ROW_DELTA_INITIAL_ROW = { 0, 1, 1, 0, 0, false, false, false, false, false };
+
+Bus::Bus() {
+	total_cycles     = 0;
+	write_pacing     = WRITE_PACING_FIXED;
+	bus_latency      = FIXED_WRITE_PACING_CYCLES;
+	wasted_cycles    = 0;
+	bus_transactions = 0;
+	status_reads     = 0;
+	coverage         = nullptr;
+
+	verilator_context = std::make_unique<VerilatedContext>();
+#if VM_TRACE
+	verilator_context->traceEverOn(true);
+#endif
+
+	verilator_sim = std::make_unique<Vtqvp_laurie_dwarf_line_table_accelerator>(verilator_context.get());
+	verilator_sim->clk          = 0;
+	verilator_sim->rst_n        = 0;
+	verilator_sim->ui_in        = 0;
+	verilator_sim->address      = 0;
+	verilator_sim->data_in      = 0;
+	verilator_sim->data_write_n = 3;
+	verilator_sim->data_read_n  = 3;
+	run_cycle();
+	verilator_sim->rst_n = 1;
+	run_cycle();
+}
+
+Bus::~Bus() {
+	verilator_sim->final();
+}
+
+void Bus::set_write_pacing(WritePacing write_pacing_in, uint32_t bus_latency_in) {
+	write_pacing = write_pacing_in;
+	bus_latency  = bus_latency_in;
+}
+
+// The data is sampled before the clock edge that completes the read, so before any side effect of
+// the read, such as the row popped by a read of ROW_DELTA, is visible. The read is deasserted after
+// that edge so that it only takes effect once.
+uint32_t Bus::read_dword(uint8_t reg) {
+	bus_transactions += 1;
+	if (reg == STATUS) {
+		status_reads += 1;
+	}
+	verilator_sim->address     = reg;
+	verilator_sim->data_read_n = 2;
+	verilator_sim->eval();
+	while (!verilator_sim->data_ready) {
+		run_cycle();
+	}
+	uint32_t const data = verilator_sim->data_out;
+	run_cycle();
+	verilator_sim->data_read_n = 3;
+	return data;
+}
+
+void Bus::write_dword(uint8_t reg, uint32_t dword) {
+	bus_transactions += 1;
+	verilator_sim->address      = reg;
+	verilator_sim->data_in      = dword;
+	verilator_sim->data_write_n = 2;
+	run_cycle();
+	verilator_sim->data_write_n = 3;
+	wait_after_write(reg);
+}
+
+void Bus::write_word(uint8_t reg, uint16_t word) {
+	bus_transactions += 1;
+	verilator_sim->address = reg;
+	verilator_sim->data_in = word;
+	verilator_sim->data_write_n = 1;
+	run_cycle();
+	verilator_sim->data_write_n = 3;
+	wait_after_write(reg);
+}
+
+void Bus::write_byte(uint8_t reg, uint8_t byte) {
+	bus_transactions += 1;
+	verilator_sim->address = reg;
+	verilator_sim->data_in = byte;
+	verilator_sim->data_write_n = 0;
+	run_cycle();
+	verilator_sim->data_write_n = 3;
+	wait_after_write(reg);
+}
+
+// Sample a register combinationally without clocking the model. Only for registers whose reads
+// have no side effects, such as STATUS and CODE_FIFO, so this observes the peripheral without
+// costing a bus transaction or disturbing its state. It must never be used on ROW_DELTA, a read of
+// which pops the row queue.
+uint32_t Bus::peek_dword(uint8_t reg) {
+	uint8_t const address     = verilator_sim->address;
+	uint8_t const data_read_n = verilator_sim->data_read_n;
+
+	verilator_sim->address     = reg;
+	verilator_sim->data_read_n = 2;
+	verilator_sim->eval();
+	uint32_t const value = verilator_sim->data_out;
+
+	verilator_sim->address     = address;
+	verilator_sim->data_read_n = data_read_n;
+	verilator_sim->eval();
+
+	return value;
+}
+
+// Run the model until the interrupt is raised, returning false if it isn't within
+// INTERRUPT_TIMEOUT_CYCLES. Observing the interrupt is free, since it's a wire rather than a register
+// read.
+bool Bus::wait_for_interrupt() {
+	for (uint32_t cycles = 0; !verilator_sim->user_interrupt; ++cycles) {
+		if (cycles == INTERRUPT_TIMEOUT_CYCLES) {
+			return false;
+		}
+		run_cycle();
+	}
+	return true;
+}
+
+// Read the row at the head of the row queue from the AM registers, without popping it.
+LineTableRow Bus::read_row() {
+	uint32_t const address        = read_dword(AM_ADDRESS);
+	uint32_t const file_discrim   = read_dword(AM_FILE_DISCRIM);
+	uint32_t const line_col_flags = read_dword(AM_LINE_COL_FLAGS);
+
+	LineTableRow row;
+	row.address        = address;
+	row.file           = file_discrim & 0xFFFF;
+	row.line           = line_col_flags & 0xFFFF;
+	row.column         = (line_col_flags >> 16) & 0x3FF;
+	row.discriminator  = file_discrim >> 16;
+	row.is_stmt        = ((line_col_flags >> 26) & 1) == 1;
+	row.basic_block    = ((line_col_flags >> 27) & 1) == 1;
+	row.end_sequence   = ((line_col_flags >> 28) & 1) == 1;
+	row.prologue_end   = ((line_col_flags >> 29) & 1) == 1;
+	row.epilogue_begin = ((line_col_flags >> 30) & 1) == 1;
+	return row;
+}
+
+// Read and pop the row at the head of the row queue. With ROW_DRAIN_DELTA, most rows only take a
+// read of ROW_DELTA, which pops the row itself, and are rebuilt from prev_row, the last row popped.
+// Rows that don't fit, and every row with ROW_DRAIN_REGISTERS, are read from the AM registers and
+// popped with ROW_POP.
+LineTableRow Bus::pop_row(RowDrain row_drain, LineTableRow const &prev_row) {
+	if (row_drain == ROW_DRAIN_DELTA) {
+		uint32_t const delta = read_dword(ROW_DELTA);
+		if ((delta & ROW_DELTA_ESCAPE) == 0) {
+			int32_t const line_delta = (int32_t)((delta & ROW_DELTA_LINE_MASK) << 25) >> 25;
+			uint32_t const flags     = delta >> ROW_DELTA_FLAGS_SHIFT;
+
+			LineTableRow row;
+			row.address        = (prev_row.address + ((delta >> ROW_DELTA_ADDRESS_SHIFT) & ROW_DELTA_ADDRESS_MASK)) & 0xFFFFFFF;
+			row.file           = prev_row.file;
+			row.line           = prev_row.line + line_delta;
+			row.column         = (delta >> ROW_DELTA_COLUMN_SHIFT) & ROW_DELTA_COLUMN_MASK;
+			row.discriminator  = 0;
+			row.is_stmt        = (flags & 1) == 1;
+			row.basic_block    = ((flags >> 1) & 1) == 1;
+			row.end_sequence   = ((flags >> 2) & 1) == 1;
+			row.prologue_end   = ((flags >> 3) & 1) == 1;
+			row.epilogue_begin = ((flags >> 4) & 1) == 1;
+			return row;
+		}
+	}
+
+	LineTableRow const row = read_row();
+	write_dword(ROW_POP, 0);
+	return row;
+}
+
+void Bus::run_cycles(uint32_t cycles) {
+	for (uint32_t i = 0; i < cycles; ++i) {
+		run_cycle();
+	}
+}
+
+void Bus::run_cycle() {
+	total_cycles += 1;
+	verilator_sim->eval();
+	if (capture.enabled()) {
+		capture.record(total_cycles, *verilator_sim);
+	}
+	if (coverage) {
+		coverage->sample(*verilator_sim);
+	}
+	verilator_sim->clk = 1;
+	verilator_sim->eval();
+	verilator_sim->clk = 0;
+}
+
+// Whether the peripheral is ready for another write to reg.
+bool Bus::ready_for_write(uint8_t reg) {
+	if (reg == PROGRAM_CODE) {
+		return (peek_dword(CODE_FIFO) & CODE_FIFO_FREE_MASK) != 0;
+	}
+	return peek_status() != STATUS_BUSY;
+}
+
+// Under adaptive pacing, wasted_cycles counts the idle cycles that fixed pacing at the same bus
+// latency would have run after this write on top of the ones actually run. Program code is queued
+// in the CODE_FIFO, so a PROGRAM_CODE write only has to wait for a free entry; any other write
+// waits for the peripheral to leave BUSY.
+void Bus::wait_after_write(uint8_t reg) {
+	if (write_pacing == WRITE_PACING_FIXED) {
+		run_cycles(bus_latency);
+		return;
+	}
+
+	uint32_t cycles_run = 0;
+	while (cycles_run < bus_latency && !ready_for_write(reg)) {
+		run_cycle();
+		cycles_run += 1;
+	}
+	wasted_cycles += bus_latency - cycles_run;
+}
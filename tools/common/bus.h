@@ -0,0 +1,142 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+
+#include "Vtqvp_laurie_dwarf_line_table_accelerator.h"
+
+#include "capture.h"
+#include "coverage.h"
+#include "line_table.h"
+
+// The peripheral's register interface, shared by every driver that runs its Verilator model.
+
+#define PROGRAM_HEADER    0x00
+#define PROGRAM_CODE      0x04
+#define AM_ADDRESS        0x08
+#define AM_FILE_DISCRIM   0x0C
+#define AM_LINE_COL_FLAGS 0x10
+#define STATUS            0x14
+#define INFO              0x18
+#define CODE_FIFO         0x1C
+#define ROW_POP           0x20
+#define FILTER_LO         0x24
+#define FILTER_HI         0x28
+#define FILTER_CTRL       0x2C
+#define ROW_DELTA         0x30
+#define INT_MASK          0x34
+
+#define STATUS_READY    0x0
+#define STATUS_EMIT_ROW 0x1
+#define STATUS_BUSY     0x2
+#define STATUS_ILLEGAL  0x3
+
+// Fields of the STATUS register.
+#define STATUS_CODE_MASK       0x3
+#define STATUS_ROW_QUEUE_SHIFT 2
+#define STATUS_ROW_QUEUE_MASK  0x3
+
+// Fields of the CODE_FIFO register.
+#define CODE_FIFO_FREE_MASK   0x7
+#define CODE_FIFO_LEVEL_SHIFT 4
+#define CODE_FIFO_LEVEL_MASK  0x7
+
+// Fields of the FILTER_CTRL register.
+#define FILTER_CTRL_ADDRESS      0x1 // only report rows covering [FILTER_LO, FILTER_HI)
+#define FILTER_CTRL_IS_STMT      0x2 // drop rows that are not statements
+#define FILTER_CTRL_END_SEQUENCE 0x4 // always report end sequence rows
+
+// Fields of the ROW_DELTA register.
+#define ROW_DELTA_VALID         0x80000000
+#define ROW_DELTA_ESCAPE        0x40000000
+#define ROW_DELTA_FLAGS_SHIFT   25
+#define ROW_DELTA_COLUMN_SHIFT  15
+#define ROW_DELTA_COLUMN_MASK   0x3FF
+#define ROW_DELTA_ADDRESS_SHIFT 7
+#define ROW_DELTA_ADDRESS_MASK  0xFF
+#define ROW_DELTA_LINE_MASK     0x7F
+
+// Fields of the INT_MASK register.
+#define INT_MASK_EMIT_ROW 0x1 // rows are queued
+#define INT_MASK_ILLEGAL  0x2 // stopped on an illegal instruction
+#define INT_MASK_READY    0x4 // went from busy to ready, until the next write acknowledges it
+#define INT_MASK_CODE     0x8 // the program code FIFO has room for a burst of writes
+#define INT_MASK_ALL      0xF
+
+// The most cycles to wait for an interrupt before giving up on it.
+#define INTERRUPT_TIMEOUT_CYCLES 100000
+
+// The row ROW_DELTA is relative to at the start of a program and after an end sequence row.
+extern LineTableRow const ROW_DELTA_INITIAL_ROW;
+
+// The number of idle cycles the drivers have historically run after every register write.
+#define FIXED_WRITE_PACING_CYCLES 8
+
+enum WritePacing
+{
+	WRITE_PACING_FIXED,    // always run bus_latency cycles after a write
+	WRITE_PACING_ADAPTIVE, // run until the peripheral can take the next write, or bus_latency cycles have elapsed
+};
+
+enum StatusWait
+{
+	STATUS_WAIT_POLL,      // poll STATUS until there is something to do
+	STATUS_WAIT_INTERRUPT, // wait for the interrupt before reading STATUS
+};
+
+enum RowDrain
+{
+	ROW_DRAIN_REGISTERS, // read the AM registers, then write ROW_POP
+	ROW_DRAIN_DELTA,     // read ROW_DELTA, falling back to the AM registers on an escape
+};
+
+// Owns a reset instance of the model and performs bus transactions on it one clock cycle at a time.
+class Bus
+{
+	std::unique_ptr<VerilatedContext> verilator_context;
+	std::unique_ptr<Vtqvp_laurie_dwarf_line_table_accelerator> verilator_sim;
+
+	uint64_t total_cycles;
+
+	WritePacing write_pacing;
+	uint32_t bus_latency;
+	uint64_t wasted_cycles;
+	uint64_t bus_transactions;
+	uint64_t status_reads;
+
+	CycleCapture capture;
+	Coverage *coverage;
+
+public:
+	Bus();
+	~Bus();
+
+	void set_write_pacing(WritePacing write_pacing_in, uint32_t bus_latency_in);
+	void set_capture(uint32_t cycles) { capture.set_size(cycles); }
+	bool write_capture(char const *file_name) const { return capture.write_vcd(file_name); }
+	void set_coverage(Coverage *coverage_in) { coverage = coverage_in; }
+
+	uint32_t read_dword(uint8_t reg);
+	void write_dword(uint8_t reg, uint32_t dword);
+	void write_word(uint8_t reg, uint16_t word);
+	void write_byte(uint8_t reg, uint8_t byte);
+	uint32_t peek_dword(uint8_t reg);
+	uint32_t peek_status() { return peek_dword(STATUS) & STATUS_CODE_MASK; }
+
+	bool wait_for_interrupt();
+
+	LineTableRow read_row();
+	LineTableRow pop_row(RowDrain row_drain, LineTableRow const &prev_row);
+
+	void run_cycles(uint32_t cycles);
+	void run_cycle();
+
+	uint64_t cycle_count() const { return total_cycles; }
+	uint64_t wasted_cycle_count() const { return wasted_cycles; }
+	uint64_t bus_transaction_count() const { return bus_transactions; }
+	uint64_t status_read_count() const { return status_reads; }
+
+private:
+	bool ready_for_write(uint8_t reg);
+	void wait_after_write(uint8_t reg);
+};
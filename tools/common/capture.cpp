@@ -0,0 +1,125 @@
+#include "capture.h"
+
+#include <cstdio>
+
+#include "Vtqvp_laurie_dwarf_line_table_accelerator___024root.h"
+
+// A signal in the waveform, with its VCD identifier. Internal signals are fields of capture_state or
+// coverage_state, at the given shift.
+struct CaptureSignal
+{
+	char const *name;
+	char const *id;
+	uint32_t width;
+	uint32_t CycleState::*value32;
+	uint8_t CycleState::*value8;
+	uint32_t shift;
+};
+
+static CaptureSignal const capture_signals[] = {
+	{ "rst_n",                  "r", 1,  nullptr,                     &CycleState::rst_n,          0 },
+	{ "ui_in",                  "u", 8,  nullptr,                     &CycleState::ui_in,          0 },
+	{ "uo_out",                 "o", 8,  nullptr,                     &CycleState::uo_out,         0 },
+	{ "address",                "a", 6,  nullptr,                     &CycleState::address,        0 },
+	{ "data_in",                "i", 32, &CycleState::data_in,        nullptr,                     0 },
+	{ "data_write_n",           "w", 2,  nullptr,                     &CycleState::data_write_n,   0 },
+	{ "data_read_n",            "R", 2,  nullptr,                     &CycleState::data_read_n,    0 },
+	{ "data_out",               "d", 32, &CycleState::data_out,       nullptr,                     0 },
+	{ "data_ready",             "y", 1,  nullptr,                     &CycleState::data_ready,     0 },
+	{ "user_interrupt",         "n", 1,  nullptr,                     &CycleState::user_interrupt, 0 },
+	{ "st_state",               "s", 5,  &CycleState::capture_state,  nullptr,                     0 },
+	{ "st_current_instruction", "I", 4,  &CycleState::capture_state,  nullptr,                     5 },
+	{ "st_program_code_level",  "f", 3,  &CycleState::capture_state,  nullptr,                     9 },
+	{ "st_row_queue_level",     "q", 2,  &CycleState::capture_state,  nullptr,                     12 },
+	{ "low_opcode_base",        "b", 1,  &CycleState::coverage_state, nullptr,                     9 },
+	{ "strobes",                "S", 12, &CycleState::coverage_state, nullptr,                     10 },
+};
+
+static uint32_t signal_value(CaptureSignal const &signal, CycleState const &state) {
+	uint32_t const value = signal.value32 ? state.*signal.value32 : state.*signal.value8;
+	return signal.width == 32 ? value : (value >> signal.shift) & ((1u << signal.width) - 1);
+}
+
+static void write_value(FILE *file, CaptureSignal const &signal, uint32_t value) {
+	if (signal.width == 1) {
+		fprintf(file, "%u%s\n", value & 1, signal.id);
+		return;
+	}
+	fputc('b', file);
+	for (int32_t bit = signal.width - 1; bit >= 0; --bit) {
+		fputc((value >> bit) & 1 ? '1' : '0', file);
+	}
+	fprintf(file, " %s\n", signal.id);
+}
+
+// Set the number of cycles kept, discarding anything already captured. A size of 0 disables the
+// capture.
+void CycleCapture::set_size(uint32_t num_cycles) {
+	cycles.assign(num_cycles, CycleState { });
+	next    = 0;
+	wrapped = false;
+}
+
+void CycleCapture::record(uint64_t cycle, Vtqvp_laurie_dwarf_line_table_accelerator const &model) {
+	CycleState &state    = cycles[next];
+	state.cycle          = cycle;
+	state.data_in        = model.data_in;
+	state.data_out       = model.data_out;
+	state.capture_state  = model.rootp->tqvp_laurie_dwarf_line_table_accelerator__DOT__capture_state;
+	state.coverage_state = model.rootp->tqvp_laurie_dwarf_line_table_accelerator__DOT__coverage_state;
+	state.rst_n          = model.rst_n;
+	state.ui_in          = model.ui_in;
+	state.uo_out         = model.uo_out;
+	state.address        = model.address;
+	state.data_write_n   = model.data_write_n;
+	state.data_read_n    = model.data_read_n;
+	state.data_ready     = model.data_ready;
+	state.user_interrupt = model.user_interrupt;
+
+	next += 1;
+	if (next == cycles.size()) {
+		next    = 0;
+		wrapped = true;
+	}
+}
+
+// Write the captured cycles, oldest first, as a VCD with one time unit per half cycle. Signals are
+// only dumped when they change, other than on the first cycle.
+bool CycleCapture::write_vcd(char const *file_name) const {
+	size_t const count = wrapped ? cycles.size() : next;
+	if (count == 0) {
+		return false;
+	}
+
+	FILE *file = fopen(file_name, "w");
+	if (!file) {
+		return false;
+	}
+
+	fprintf(file, "$timescale 1ns $end\n");
+	fprintf(file, "$scope module tqvp_laurie_dwarf_line_table_accelerator $end\n");
+	fprintf(file, "$var wire 1 c clk $end\n");
+	for (CaptureSignal const &signal : capture_signals) {
+		fprintf(file, "$var wire %u %s %s $end\n", signal.width, signal.id, signal.name);
+	}
+	fprintf(file, "$upscope $end\n");
+	fprintf(file, "$enddefinitions $end\n");
+
+	size_t const first = wrapped ? next : 0;
+	CycleState const *prev_state = nullptr;
+	for (size_t i = 0; i < count; ++i) {
+		CycleState const &state = cycles[(first + i) % cycles.size()];
+		fprintf(file, "#%llu\n0c\n", (unsigned long long)(state.cycle * 2));
+		for (CaptureSignal const &signal : capture_signals) {
+			uint32_t const value = signal_value(signal, state);
+			if (!prev_state || signal_value(signal, *prev_state) != value) {
+				write_value(file, signal, value);
+			}
+		}
+		fprintf(file, "#%llu\n1c\n", (unsigned long long)(state.cycle * 2 + 1));
+		prev_state = &state;
+	}
+
+	fclose(file);
+	return true;
+}
@@ -0,0 +1,47 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include "Vtqvp_laurie_dwarf_line_table_accelerator.h"
+
+// The ports of the peripheral on one cycle, and the internal state it exposes for capture, sampled
+// just before the rising edge.
+struct CycleState
+{
+	uint64_t cycle;
+	uint32_t data_in;
+	uint32_t data_out;
+	uint32_t capture_state;
+	uint32_t coverage_state;
+	uint8_t rst_n;
+	uint8_t ui_in;
+	uint8_t uo_out;
+	uint8_t address;
+	uint8_t data_write_n;
+	uint8_t data_read_n;
+	uint8_t data_ready;
+	uint8_t user_interrupt;
+};
+
+// Keeps the state of the last few cycles in a ring buffer, so that a waveform of the cycles leading
+// up to a failure can be written without tracing the whole run. This works without building the
+// model with --trace, so it costs a copy of the state per cycle rather than a trace. Alongside the
+// ports, it records the capture_state signal, which packs the state machine, the current
+// instruction, and the occupancy of the program code FIFO and the row queue, and the control
+// strobes of the coverage_state signal.
+class CycleCapture
+{
+	std::vector<CycleState> cycles;
+	size_t next;
+	bool wrapped;
+
+public:
+	CycleCapture() : next(0), wrapped(false) { }
+
+	void set_size(uint32_t num_cycles);
+	bool enabled() const { return !cycles.empty(); }
+
+	void record(uint64_t cycle, Vtqvp_laurie_dwarf_line_table_accelerator const &model);
+	bool write_vcd(char const *file_name) const;
+};
@@ -0,0 +1,35 @@
+#include "coverage.h"
+
+#include "Vtqvp_laurie_dwarf_line_table_accelerator___024root.h"
+
+void Coverage::clear() {
+	points.reset();
+	prev_state = 0;
+}
+
+void Coverage::sample(Vtqvp_laurie_dwarf_line_table_accelerator const &model) {
+	uint32_t const coverage_state  = model.rootp->tqvp_laurie_dwarf_line_table_accelerator__DOT__coverage_state;
+	uint32_t const state           = coverage_state & COVERAGE_STATE_MASK;
+	uint32_t const instruction     = (coverage_state >> COVERAGE_INSTRUCTION_SHIFT) & COVERAGE_INSTRUCTION_MASK;
+	uint32_t const low_opcode_base = (coverage_state >> COVERAGE_LOW_OPCODE_BASE_SHIFT) & 1;
+	uint32_t const strobes         = coverage_state >> COVERAGE_STROBES_SHIFT;
+
+	points.set(prev_state * COVERAGE_NUM_STATES + state);
+	points.set(COVERAGE_TRANSITION_POINTS +
+		(state * COVERAGE_NUM_INSTRUCTIONS + instruction) * 2 + low_opcode_base);
+	for (uint32_t strobe = 0; strobe < COVERAGE_NUM_STROBES; ++strobe) {
+		if ((strobes >> strobe) & 1) {
+			points.set(COVERAGE_TRANSITION_POINTS + COVERAGE_INSTRUCTION_POINTS +
+				state * COVERAGE_NUM_STROBES + strobe);
+		}
+	}
+
+	prev_state = state;
+}
+
+// Add the points reached by other, and return how many of them were new.
+uint32_t Coverage::merge(Coverage const &other) {
+	uint32_t const count_before = count();
+	points |= other.points;
+	return count() - count_before;
+}
@@ -0,0 +1,40 @@
+#pragma once
+
+#include <bitset>
+#include <cstdint>
+
+#include "Vtqvp_laurie_dwarf_line_table_accelerator.h"
+
+// Fields of the coverage_state signal sampled from the model.
+#define COVERAGE_STATE_MASK             0x1F
+#define COVERAGE_INSTRUCTION_SHIFT      5
+#define COVERAGE_INSTRUCTION_MASK       0xF
+#define COVERAGE_LOW_OPCODE_BASE_SHIFT  9
+#define COVERAGE_STROBES_SHIFT          10
+#define COVERAGE_NUM_STROBES            12
+
+#define COVERAGE_NUM_STATES       32
+#define COVERAGE_NUM_INSTRUCTIONS 16
+
+// Each point is a state transition, a state seen with a current instruction and opcode base
+// class, or a state seen with a control strobe active.
+#define COVERAGE_TRANSITION_POINTS  (COVERAGE_NUM_STATES * COVERAGE_NUM_STATES)
+#define COVERAGE_INSTRUCTION_POINTS (COVERAGE_NUM_STATES * COVERAGE_NUM_INSTRUCTIONS * 2)
+#define COVERAGE_STROBE_POINTS      (COVERAGE_NUM_STATES * COVERAGE_NUM_STROBES)
+#define COVERAGE_POINTS (COVERAGE_TRANSITION_POINTS + COVERAGE_INSTRUCTION_POINTS + COVERAGE_STROBE_POINTS)
+
+// The set of coverage points reached by the hardware, built up one cycle at a time from the
+// coverage_state signal.
+class Coverage
+{
+	std::bitset<COVERAGE_POINTS> points;
+	uint32_t prev_state;
+
+public:
+	Coverage() : prev_state(0) { }
+
+	void clear();
+	void sample(Vtqvp_laurie_dwarf_line_table_accelerator const &model);
+	uint32_t merge(Coverage const &other);
+	uint32_t count() const { return (uint32_t)points.count(); }
+};
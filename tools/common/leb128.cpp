@@ -0,0 +1,177 @@
+#include <cstring>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define LEB_X86 1
+#else
+#define LEB_X86 0
+#endif
+
+#include "leb128.h"
+
+char const *const leb_decoder_names[LEB_DECODER_COUNT] = {
+	"scalar",
+	"sse2",
+	"avx2",
+};
+
+// Gather the 7-bit groups of a ULEB128 of at most 8 bytes. The bytes are loaded little-endian
+// into a single word, and each step halves the number of groups by closing the gaps between
+// neighbouring pairs.
+static inline uint64_t gather_uleb(uint8_t const *bytes, uint32_t length) {
+	uint64_t x;
+	memcpy(&x, bytes, sizeof(x));
+	if (length < 8) {
+		x &= ((uint64_t)1 << (length * 8)) - 1;
+	}
+	x &= 0x7F7F7F7F7F7F7F7F;
+	x = (x & 0x007F007F007F007F) | ((x & 0x7F007F007F007F00) >> 1);
+	x = (x & 0x00003FFF00003FFF) | ((x & 0x3FFF00003FFF0000) >> 2);
+	x = (x & 0x000000000FFFFFFF) | ((x & 0x0FFFFFFF00000000) >> 4);
+	return x;
+}
+
+// Decode the values whose final byte lies in a block of BLOCK bytes starting at cur. chunk holds
+// a copy of the block followed by at least 8 zero bytes, and continuation holds the continuation
+// bit of each byte in the block. Returns the number of bytes consumed, which is 0 if no value
+// ends in the block.
+template <uint32_t BLOCK>
+static inline uint32_t decode_block(uint8_t const *chunk, uint8_t const *cur, uint64_t continuation,
+                                    uint64_t *values, size_t count, size_t &decoded) {
+	if (continuation == 0 && count - decoded >= BLOCK) {
+		// The common case in line programs: every operand is a single byte.
+		for (uint32_t i = 0; i < BLOCK; ++i) {
+			values[decoded + i] = chunk[i];
+		}
+		decoded += BLOCK;
+		return BLOCK;
+	}
+
+	uint64_t ends = ~continuation & (BLOCK == 64 ? ~(uint64_t)0 : ((uint64_t)1 << BLOCK) - 1);
+	uint32_t pos = 0;
+	while (ends != 0 && decoded < count) {
+		uint32_t const last   = __builtin_ctzll(ends);
+		uint32_t const length = last + 1 - pos;
+		if (length <= 8) {
+			values[decoded] = gather_uleb(chunk + pos, length);
+		} else {
+			decode_uleb(cur + pos, values[decoded]);
+		}
+		decoded += 1;
+		pos      = last + 1;
+		ends    &= ends - 1;
+	}
+	return pos;
+}
+
+static size_t decode_uleb_run_scalar(uint8_t const *&cur, uint8_t const *end, uint64_t *values, size_t count) {
+	size_t decoded = 0;
+	while (decoded < count) {
+		size_t const length = decode_uleb(cur, end, values[decoded]);
+		if (length == 0) {
+			break;
+		}
+		cur     += length;
+		decoded += 1;
+	}
+	return decoded;
+}
+
+// Decode one block-sized step of a run, given the block's continuation bits. A value longer than
+// the block is decoded on its own. Returns false if the run reaches end mid-value.
+template <uint32_t BLOCK>
+static inline bool decode_step(uint8_t const *chunk, uint64_t continuation, uint8_t const *&cur,
+                               uint8_t const *end, uint64_t *values, size_t count, size_t &decoded) {
+	uint32_t const consumed = decode_block<BLOCK>(chunk, cur, continuation, values, count, decoded);
+	if (consumed != 0) {
+		cur += consumed;
+		return true;
+	}
+	size_t const length = decode_uleb(cur, end, values[decoded]);
+	if (length == 0) {
+		return false;
+	}
+	cur     += length;
+	decoded += 1;
+	return true;
+}
+
+#if LEB_X86
+
+static size_t decode_uleb_run_sse2(uint8_t const *&cur, uint8_t const *end, uint64_t *values, size_t count) {
+	alignas(16) uint8_t chunk[16 + 16] = { };
+	size_t decoded = 0;
+	while (decoded < count && end - cur >= 16) {
+		__m128i const bytes = _mm_loadu_si128((__m128i const *)cur);
+		_mm_store_si128((__m128i *)chunk, bytes);
+		uint64_t const continuation = (uint32_t)_mm_movemask_epi8(bytes);
+		if (!decode_step<16>(chunk, continuation, cur, end, values, count, decoded)) {
+			return decoded;
+		}
+	}
+	return decoded + decode_uleb_run_scalar(cur, end, values + decoded, count - decoded);
+}
+
+__attribute__((target("avx2")))
+static size_t decode_uleb_run_avx2(uint8_t const *&cur, uint8_t const *end, uint64_t *values, size_t count) {
+	alignas(32) uint8_t chunk[32 + 32] = { };
+	size_t decoded = 0;
+	while (decoded < count && end - cur >= 32) {
+		__m256i const bytes = _mm256_loadu_si256((__m256i const *)cur);
+		_mm256_store_si256((__m256i *)chunk, bytes);
+		uint64_t const continuation = (uint32_t)_mm256_movemask_epi8(bytes);
+		if (!decode_step<32>(chunk, continuation, cur, end, values, count, decoded)) {
+			_mm256_zeroupper();
+			return decoded;
+		}
+	}
+	// GCC doesn't reliably clear the upper halves before this call, and the legacy SSE encoded
+	// tail runs several times slower than the scalar decoder while they're dirty.
+	_mm256_zeroupper();
+	return decoded + decode_uleb_run_sse2(cur, end, values + decoded, count - decoded);
+}
+
+#endif
+
+bool leb_decoder_supported(LebDecoder decoder) {
+	switch (decoder) {
+		case LEB_DECODER_SCALAR: {
+			return true;
+		}
+#if LEB_X86
+		case LEB_DECODER_SSE2: {
+			return __builtin_cpu_supports("sse2");
+		}
+		case LEB_DECODER_AVX2: {
+			return __builtin_cpu_supports("avx2");
+		}
+#endif
+		default: {
+			return false;
+		}
+	}
+}
+
+LebDecoder best_leb_decoder() {
+	static LebDecoder const best =
+		leb_decoder_supported(LEB_DECODER_AVX2) ? LEB_DECODER_AVX2 :
+		leb_decoder_supported(LEB_DECODER_SSE2) ? LEB_DECODER_SSE2 :
+		                                          LEB_DECODER_SCALAR;
+	return best;
+}
+
+size_t decode_uleb_run(LebDecoder decoder, uint8_t const *&cur, uint8_t const *end, uint64_t *values, size_t count) {
+	switch (decoder) {
+#if LEB_X86
+		case LEB_DECODER_SSE2: {
+			return decode_uleb_run_sse2(cur, end, values, count);
+		}
+		case LEB_DECODER_AVX2: {
+			return decode_uleb_run_avx2(cur, end, values, count);
+		}
+#endif
+		default: {
+			return decode_uleb_run_scalar(cur, end, values, count);
+		}
+	}
+}
@@ -0,0 +1,104 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// LEB128 encoding and decoding shared by the ELF parser, the reference model, the software
+// decoder, and show-asm's compact line table. Bits beyond the 64th are discarded, so callers that
+// model narrower hardware registers mask the result themselves.
+
+// Decode a single ULEB128, returning the number of bytes consumed.
+inline size_t decode_uleb(uint8_t const *cur, uint64_t &value) {
+	uint8_t const *const start = cur;
+	uint64_t result = 0;
+	uint32_t shift = 0;
+	uint8_t byte;
+	do {
+		byte = *cur++;
+		if (shift < 64) {
+			result |= (uint64_t)(byte & 0x7F) << shift;
+		}
+		shift += 7;
+	} while ((byte & 0x80) != 0);
+	value = result;
+	return cur - start;
+}
+
+// Decode a single SLEB128, returning the number of bytes consumed.
+inline size_t decode_sleb(uint8_t const *cur, int64_t &value) {
+	uint8_t const *const start = cur;
+	uint64_t result = 0;
+	uint32_t shift = 0;
+	uint8_t byte;
+	do {
+		byte = *cur++;
+		if (shift < 64) {
+			result |= (uint64_t)(byte & 0x7F) << shift;
+		}
+		shift += 7;
+	} while ((byte & 0x80) != 0);
+	if (shift < 64 && ((byte >> 6) & 1) == 1) {
+		result |= ~(uint64_t)0 << shift;
+	}
+	value = (int64_t)result;
+	return cur - start;
+}
+
+// Bounded versions of the above, which return 0 if the value runs past end.
+
+inline size_t decode_uleb(uint8_t const *cur, uint8_t const *end, uint64_t &value) {
+	for (uint8_t const *last = cur; last < end; ++last) {
+		if ((*last & 0x80) == 0) {
+			return decode_uleb(cur, value);
+		}
+	}
+	return 0;
+}
+
+inline size_t decode_sleb(uint8_t const *cur, uint8_t const *end, int64_t &value) {
+	for (uint8_t const *last = cur; last < end; ++last) {
+		if ((*last & 0x80) == 0) {
+			return decode_sleb(cur, value);
+		}
+	}
+	return 0;
+}
+
+// Append value to out as a ULEB128.
+inline void encode_uleb(uint64_t value, std::vector<uint8_t> &out) {
+	do {
+		uint8_t byte = value & 0x7F;
+		value >>= 7;
+		if (value != 0) {
+			byte |= 0x80;
+		}
+		out.push_back(byte);
+	} while (value != 0);
+}
+
+enum LebDecoder
+{
+	LEB_DECODER_SCALAR, // one byte at a time
+	LEB_DECODER_SSE2,   // continuation bits found 16 bytes at a time
+	LEB_DECODER_AVX2,   // continuation bits found 32 bytes at a time
+	LEB_DECODER_COUNT
+};
+
+extern char const *const leb_decoder_names[LEB_DECODER_COUNT];
+
+// The fastest decoder supported by the host CPU.
+LebDecoder best_leb_decoder();
+
+bool leb_decoder_supported(LebDecoder decoder);
+
+// Decode up to count consecutive ULEB128s from [cur, end) into values, advancing cur past them.
+// Returns the number of values decoded, which is less than count only if end is reached. Line
+// program operands are interleaved with opcodes, so the line decoders use the single value
+// decoders above; this is for runs such as the entry formats of a line program header and the
+// columns of a compact line table block.
+size_t decode_uleb_run(LebDecoder decoder, uint8_t const *&cur, uint8_t const *end, uint64_t *values, size_t count);
+
+inline size_t decode_uleb_run(uint8_t const *&cur, uint8_t const *end, uint64_t *values, size_t count) {
+	return decode_uleb_run(best_leb_decoder(), cur, end, values, count);
+}
@@ -0,0 +1,283 @@
+#include <cstring>
+
+#include "leb128.h"
+#include "line_decoder.h"
+
+#define DW_LNS_COPY             0x01
+#define DW_LNS_ADVANCEPC        0x02
+#define DW_LNS_ADVANCELINE      0x03
+#define DW_LNS_SETFILE          0x04
+#define DW_LNS_SETCOLUMN        0x05
+#define DW_LNS_NEGATESTMT       0x06
+#define DW_LNS_SETBASICBLOCK    0x07
+#define DW_LNS_CONSTADDPC       0x08
+#define DW_LNS_FIXEDADVANCEPC   0x09
+#define DW_LNS_SETPROLOGUEEND   0x0A
+#define DW_LNS_SETEPILOGUEBEGIN 0x0B
+#define DW_LNS_SETISA           0x0C
+
+#define EXTENDED_OPCODE_START   0x00
+#define DW_LNE_ENDSEQUENCE      0x01
+#define DW_LNE_SETADDRESS       0x02
+#define DW_LNE_SETDISCRIMINATOR 0x04
+
+#define ADDRESS_MASK 0xFFFFFFF
+#define COLUMN_MASK  0x3FF
+
+// Operand readers. These match the accelerator's handling of oversized operands, and return false
+// if the operand runs off the end of the program.
+
+// Operand readers. A value that runs past end reads as zero and leaves cur where it was.
+static bool read_uleb(uint8_t const *&cur, uint8_t const *end, uint32_t &value) {
+	uint64_t result = 0;
+	size_t const length = decode_uleb(cur, end, result);
+	cur  += length;
+	value = result & ADDRESS_MASK;
+	return length != 0;
+}
+
+static bool read_sleb(uint8_t const *&cur, uint8_t const *end, int32_t &value) {
+	int64_t result = 0;
+	size_t const length = decode_sleb(cur, end, result);
+	cur  += length;
+	value = (int32_t)result;
+	return length != 0;
+}
+
+template <typename T>
+static bool read_fixed(uint8_t const *&cur, uint8_t const *end, T &value) {
+	if ((size_t)(end - cur) < sizeof(value)) {
+		value = 0;
+		return false;
+	}
+	memcpy(&value, cur, sizeof(value));
+	cur += sizeof(value);
+	return true;
+}
+
+LineDecoder::LineDecoder(uint32_t program_header) {
+	int8_t line_base;
+	uint8_t line_range;
+
+	default_is_stmt = (program_header & 1) == 1;
+	line_base       = (int8_t)((program_header >> 8) & 0xFF);
+	line_range      = (program_header >> 16) & 0xFF;
+	opcode_base     = (program_header >> 24) & 0xFF;
+
+	// The accelerator treats a line_range of 0 as 1, since it would otherwise never finish.
+	if (line_range == 0) {
+		line_range = 1;
+	}
+
+	for (uint32_t opcode = 0; opcode < 256; ++opcode) {
+		uint8_t const adjusted_opcode = opcode - opcode_base;
+		special_opcodes[opcode].address_advance = adjusted_opcode / line_range;
+		special_opcodes[opcode].line_advance    = line_base + (adjusted_opcode % line_range);
+	}
+	const_add_pc_advance = special_opcodes[255].address_advance;
+}
+
+// Receives rows into a preallocated buffer.
+struct TableSink
+{
+	LineTableRow *rows;
+	size_t num_rows;
+
+	void emit(LineTableRow const &row, uint8_t const *) {
+		rows[num_rows++] = row;
+	}
+};
+
+// Records the extent of each sequence, and the files its rows refer to, without keeping the rows.
+struct SequenceSink
+{
+	uint8_t const *program_code;
+	std::vector<SequenceInfo> &sequences;
+	std::vector<uint16_t> &files;
+	SequenceInfo sequence;
+
+	SequenceSink(uint8_t const *program_code_in, std::vector<SequenceInfo> &sequences_in, std::vector<uint16_t> &files_in)
+		: program_code(program_code_in), sequences(sequences_in), files(files_in) {
+		start_sequence(0);
+	}
+
+	void start_sequence(uint32_t offset) {
+		sequence = { offset, 0, 0, 0, 0, (uint32_t)files.size(), 0 };
+	}
+
+	void emit(LineTableRow const &row, uint8_t const *next) {
+		if (sequence.num_rows == 0) {
+			sequence.start_address = row.address;
+		}
+		sequence.num_rows += 1;
+
+		// Rows rarely change file within a sequence, so a linear search of its files is cheap.
+		bool seen_file = false;
+		for (uint32_t i = sequence.files_first; i < files.size() && !seen_file; ++i) {
+			seen_file = files[i] == row.file;
+		}
+		if (!seen_file) {
+			files.push_back(row.file);
+			sequence.files_count += 1;
+		}
+
+		if (row.end_sequence) {
+			uint32_t const next_offset = next - program_code;
+			sequence.size        = next_offset - sequence.offset;
+			sequence.end_address = row.address;
+			sequences.push_back(sequence);
+			start_sequence(next_offset);
+		}
+	}
+};
+
+bool LineDecoder::decode(uint8_t const *program_code, size_t program_code_size, LineTable &line_table) const {
+	// Every row is emitted by at least one byte of program code, so the program size bounds the
+	// number of rows. Rows are written straight into this buffer and it is trimmed at the end.
+	size_t const first_row = line_table.size();
+	line_table.resize(first_row + program_code_size);
+	TableSink sink { line_table.data() + first_row, 0 };
+
+	bool const legal = run(program_code, program_code_size, sink);
+
+	line_table.resize(first_row + sink.num_rows);
+
+	return legal;
+}
+
+bool LineDecoder::scan(uint8_t const *program_code, size_t program_code_size, std::vector<SequenceInfo> &sequences,
+                       std::vector<uint16_t> &files) const {
+	SequenceSink sink { program_code, sequences, files };
+
+	bool const legal = run(program_code, program_code_size, sink);
+
+	// Drop the files of a trailing sequence with no end, since the sequence itself is dropped.
+	files.resize(sink.sequence.files_first);
+
+	return legal;
+}
+
+template <typename RowSink>
+bool LineDecoder::run(uint8_t const *program_code, size_t program_code_size, RowSink &sink) const {
+	uint8_t const *cur = program_code;
+	uint8_t const *end = program_code + program_code_size;
+
+	LineTableRow state;
+	bool legal = true;
+
+	auto reset_state = [&]() {
+		state.address        = 0;
+		state.file           = 1;
+		state.line           = 1;
+		state.column         = 0;
+		state.discriminator  = 0;
+		state.is_stmt        = default_is_stmt;
+		state.basic_block    = false;
+		state.end_sequence   = false;
+		state.prologue_end   = false;
+		state.epilogue_begin = false;
+	};
+
+	auto emit_row = [&]() {
+		sink.emit(state, cur);
+		state.discriminator  = 0;
+		state.basic_block    = false;
+		state.prologue_end   = false;
+		state.epilogue_begin = false;
+	};
+
+	reset_state();
+
+	while (cur < end && legal) {
+		uint8_t const opcode = *cur++;
+
+		if (opcode >= opcode_base) {
+			SpecialOpcode const &special_opcode = special_opcodes[opcode];
+			state.address = (state.address + special_opcode.address_advance) & ADDRESS_MASK;
+			state.line    = state.line + special_opcode.line_advance;
+			emit_row();
+			continue;
+		}
+
+		uint32_t operand;
+		int32_t signed_operand;
+		bool complete = true;
+
+		switch (opcode) {
+			case EXTENDED_OPCODE_START: {
+				complete = read_uleb(cur, end, operand) && cur < end;
+				if (!complete) {
+					break;
+				}
+				uint8_t const extended_opcode = *cur++;
+				if (extended_opcode == DW_LNE_ENDSEQUENCE) {
+					state.end_sequence = true;
+					emit_row();
+					reset_state();
+				} else if (extended_opcode == DW_LNE_SETADDRESS) {
+					uint32_t address;
+					complete = read_fixed(cur, end, address);
+					state.address = address & ADDRESS_MASK;
+				} else if (extended_opcode == DW_LNE_SETDISCRIMINATOR) {
+					complete = read_uleb(cur, end, operand);
+					state.discriminator = operand;
+				} else {
+					legal = false;
+				}
+			} break;
+			case DW_LNS_COPY: {
+				emit_row();
+			} break;
+			case DW_LNS_ADVANCEPC: {
+				complete = read_uleb(cur, end, operand);
+				state.address = (state.address + operand) & ADDRESS_MASK;
+			} break;
+			case DW_LNS_ADVANCELINE: {
+				complete = read_sleb(cur, end, signed_operand);
+				state.line = (uint16_t)((int16_t)state.line + signed_operand);
+			} break;
+			case DW_LNS_SETFILE: {
+				complete = read_uleb(cur, end, operand);
+				state.file = operand;
+			} break;
+			case DW_LNS_SETCOLUMN: {
+				complete = read_uleb(cur, end, operand);
+				state.column = operand & COLUMN_MASK;
+			} break;
+			case DW_LNS_NEGATESTMT: {
+				state.is_stmt = !state.is_stmt;
+			} break;
+			case DW_LNS_SETBASICBLOCK: {
+				state.basic_block = true;
+			} break;
+			case DW_LNS_CONSTADDPC: {
+				state.address = (state.address + const_add_pc_advance) & ADDRESS_MASK;
+			} break;
+			case DW_LNS_FIXEDADVANCEPC: {
+				uint16_t advance;
+				complete = read_fixed(cur, end, advance);
+				state.address = (state.address + advance) & ADDRESS_MASK;
+			} break;
+			case DW_LNS_SETPROLOGUEEND: {
+				state.prologue_end = true;
+			} break;
+			case DW_LNS_SETEPILOGUEBEGIN: {
+				state.epilogue_begin = true;
+			} break;
+			case DW_LNS_SETISA: {
+				complete = read_uleb(cur, end, operand);
+			} break;
+			default: {
+				legal = false;
+			} break;
+		}
+
+		// A truncated final instruction is never executed by the accelerator, since it waits for
+		// the rest of its operand, so it has no effect here either.
+		if (!complete) {
+			break;
+		}
+	}
+
+	return legal;
+}
@@ -0,0 +1,60 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "line_table.h"
+
+// Bump whenever a change to the decoder changes the rows it produces, so that line tables cached
+// by an older decoder are decoded again.
+#define LINE_DECODER_VERSION 1
+
+// The extent of one sequence of a program, which runs up to and including its end_sequence.
+struct SequenceInfo
+{
+	uint32_t offset;        // of the sequence's first instruction in the program
+	uint32_t size;          // in bytes
+	uint32_t start_address; // of the first row
+	uint32_t end_address;   // of the end_sequence row
+	uint32_t num_rows;
+	uint32_t files_first;   // index of the sequence's first file in the scanned file list
+	uint32_t files_count;   // number of distinct files the sequence's rows refer to
+};
+
+// Software implementation of the line table program decoder. Unlike the SoftwareSim test oracle,
+// which steps one instruction at a time, this decodes a whole program in a single call. Results
+// are bit-exact with the accelerator, including the 28-bit address and 16-bit file, line, and
+// discriminator (10-bit column) truncation.
+class LineDecoder
+{
+	// Address and line advance for each special opcode, precomputed from the program header so
+	// that decoding a special opcode needs no division.
+	struct SpecialOpcode
+	{
+		uint8_t address_advance;
+		uint16_t line_advance;
+	};
+
+	SpecialOpcode special_opcodes[256];
+	uint8_t const_add_pc_advance;
+	uint8_t opcode_base;
+	bool default_is_stmt;
+
+public:
+	LineDecoder(uint32_t program_header);
+
+	// Decode the program, appending the emitted rows to line_table. Returns false if the program
+	// contains an illegal instruction, in which case the rows before it are still appended.
+	bool decode(uint8_t const *program_code, size_t program_code_size, LineTable &line_table) const;
+
+	// Find the sequences of the program without keeping their rows, appending them to sequences and
+	// the files they refer to to files. A trailing sequence with no end_sequence is left out, as is
+	// anything after an illegal instruction, in which case this returns false.
+	bool scan(uint8_t const *program_code, size_t program_code_size, std::vector<SequenceInfo> &sequences,
+	          std::vector<uint16_t> &files) const;
+
+private:
+	template <typename RowSink>
+	bool run(uint8_t const *program_code, size_t program_code_size, RowSink &sink) const;
+};
@@ -0,0 +1,20 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+struct LineTableRow
+{
+	uint32_t address;
+	uint16_t file;
+	uint16_t line;
+	uint16_t column;
+	uint16_t discriminator;
+	bool is_stmt;
+	bool basic_block;
+	bool end_sequence;
+	bool prologue_end;
+	bool epilogue_begin;
+};
+
+using LineTable = std::vector<LineTableRow>;
@@ -0,0 +1,147 @@
+#include <algorithm>
+
+#include "../common/leb128.h"
+
+#include "compact_line_table.h"
+#include "line_cache.h"
+
+static uint32_t zigzag(int32_t value) {
+	return ((uint32_t)value << 1) ^ (uint32_t)(value >> 31);
+}
+
+static int32_t unzigzag(uint32_t value) {
+	return (int32_t)(value >> 1) ^ -(int32_t)(value & 1);
+}
+
+CompactLineTable::CompactLineTable(LineTable const &line_table) {
+	size_ = line_table.size();
+	blocks_.reserve((size_ + COMPACT_BLOCK_ROWS - 1) / COMPACT_BLOCK_ROWS);
+	for (std::vector<uint8_t> &column : columns_) {
+		column.reserve(size_);
+	}
+
+	LineTableRow previous { };
+	for (size_t i = 0; i < size_; ++i) {
+		LineTableRow const &row = line_table[i];
+		size_t const bit = i % COMPACT_BLOCK_ROWS;
+
+		if (bit == 0) {
+			Block block = { row.address, row.line, row.file, { }, { } };
+			for (int column = 0; column < COLUMN_COUNT; ++column) {
+				block.offsets[column] = columns_[column].size();
+			}
+			blocks_.push_back(block);
+			previous = row;
+		}
+
+		Block &block = blocks_.back();
+		block.flags[FLAG_IS_STMT]        |= (uint64_t)row.is_stmt << bit;
+		block.flags[FLAG_BASIC_BLOCK]    |= (uint64_t)row.basic_block << bit;
+		block.flags[FLAG_END_SEQUENCE]   |= (uint64_t)row.end_sequence << bit;
+		block.flags[FLAG_PROLOGUE_END]   |= (uint64_t)row.prologue_end << bit;
+		block.flags[FLAG_EPILOGUE_BEGIN] |= (uint64_t)row.epilogue_begin << bit;
+
+		encode_uleb(zigzag((int32_t)(row.address - previous.address)), columns_[COLUMN_ADDRESS]);
+		encode_uleb(zigzag((int16_t)(row.line - previous.line)), columns_[COLUMN_LINE]);
+		encode_uleb(zigzag((int16_t)(row.file - previous.file)), columns_[COLUMN_FILE]);
+		encode_uleb(row.column, columns_[COLUMN_COLUMN]);
+		encode_uleb(row.discriminator, columns_[COLUMN_DISCRIMINATOR]);
+		previous = row;
+	}
+
+	for (std::vector<uint8_t> &column : columns_) {
+		column.shrink_to_fit();
+	}
+}
+
+size_t CompactLineTable::decode_block(size_t block_index, LineTableRow *rows) const {
+	Block const &block = blocks_[block_index];
+	size_t const num_rows = std::min<size_t>(COMPACT_BLOCK_ROWS, size_ - block_index * COMPACT_BLOCK_ROWS);
+
+	// Each column of a block is a run of ULEB128s, so decode them a column at a time with the bulk
+	// decoder rather than a value at a time.
+	uint64_t values[COLUMN_COUNT][COMPACT_BLOCK_ROWS];
+	for (int column = 0; column < COLUMN_COUNT; ++column) {
+		std::vector<uint8_t> const &stream = columns_[column];
+		uint8_t const *cur = stream.data() + block.offsets[column];
+		decode_uleb_run(cur, stream.data() + stream.size(), values[column], num_rows);
+	}
+
+	uint32_t address = block.address;
+	uint16_t line    = block.line;
+	uint16_t file    = block.file;
+	for (size_t i = 0; i < num_rows; ++i) {
+		LineTableRow &row = rows[i];
+		address += unzigzag(values[COLUMN_ADDRESS][i]);
+		line    += unzigzag(values[COLUMN_LINE][i]);
+		file    += unzigzag(values[COLUMN_FILE][i]);
+
+		row.address        = address;
+		row.line           = line;
+		row.file           = file;
+		row.column         = values[COLUMN_COLUMN][i];
+		row.discriminator  = values[COLUMN_DISCRIMINATOR][i];
+		row.is_stmt        = (block.flags[FLAG_IS_STMT] >> i) & 1;
+		row.basic_block    = (block.flags[FLAG_BASIC_BLOCK] >> i) & 1;
+		row.end_sequence   = (block.flags[FLAG_END_SEQUENCE] >> i) & 1;
+		row.prologue_end   = (block.flags[FLAG_PROLOGUE_END] >> i) & 1;
+		row.epilogue_begin = (block.flags[FLAG_EPILOGUE_BEGIN] >> i) & 1;
+	}
+
+	return num_rows;
+}
+
+LineTableRow CompactLineTable::row(size_t index) const {
+	LineTableRow rows[COMPACT_BLOCK_ROWS];
+	decode_block(index / COMPACT_BLOCK_ROWS, rows);
+	return rows[index % COMPACT_BLOCK_ROWS];
+}
+
+size_t CompactLineTable::memory_usage() const {
+	size_t bytes = blocks_.capacity() * sizeof(Block);
+	for (std::vector<uint8_t> const &column : columns_) {
+		bytes += column.capacity();
+	}
+	return bytes;
+}
+
+void CompactLineTable::save(CacheWriter &writer) const {
+	writer.write(size_);
+	writer.write_array(blocks_);
+	for (std::vector<uint8_t> const &column : columns_) {
+		writer.write_array(column);
+	}
+}
+
+bool CompactLineTable::load(CacheReader &reader) {
+	if (!reader.read(size_) || !reader.read_array(blocks_)) {
+		return false;
+	}
+	for (std::vector<uint8_t> &column : columns_) {
+		if (!reader.read_array(column)) {
+			return false;
+		}
+	}
+
+	// Reject tables that would read outside their streams, by decoding each block's values with
+	// bounds checks once here so that decode_block can skip them.
+	if (blocks_.size() != (size_ + COMPACT_BLOCK_ROWS - 1) / COMPACT_BLOCK_ROWS) {
+		return false;
+	}
+	uint64_t values[COMPACT_BLOCK_ROWS];
+	for (size_t block_index = 0; block_index < blocks_.size(); ++block_index) {
+		Block const &block = blocks_[block_index];
+		size_t const num_rows = std::min<size_t>(COMPACT_BLOCK_ROWS, size_ - block_index * COMPACT_BLOCK_ROWS);
+		for (int column = 0; column < COLUMN_COUNT; ++column) {
+			std::vector<uint8_t> const &stream = columns_[column];
+			if (block.offsets[column] >= stream.size()) {
+				return false;
+			}
+			uint8_t const *cur = stream.data() + block.offsets[column];
+			if (decode_uleb_run(cur, stream.data() + stream.size(), values, num_rows) != num_rows) {
+				return false;
+			}
+		}
+	}
+	return true;
+}
@@ -0,0 +1,70 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "../common/line_table.h"
+
+class CacheReader;
+class CacheWriter;
+
+#define COMPACT_BLOCK_ROWS 64
+
+// A read-only line table stored column by column, in blocks of COMPACT_BLOCK_ROWS rows. Each flag
+// is a bitset per block. Addresses, lines, and files are stored as zigzag ULEB128 deltas from the
+// previous row in the block, and columns and discriminators as plain ULEB128s, each column in its
+// own byte stream. A block header holds the first row's values and where the block starts in
+// each stream, so reading a row decodes at most one block.
+class CompactLineTable
+{
+	enum Column
+	{
+		COLUMN_ADDRESS,
+		COLUMN_LINE,
+		COLUMN_FILE,
+		COLUMN_COLUMN,
+		COLUMN_DISCRIMINATOR,
+		COLUMN_COUNT
+	};
+
+	enum Flag
+	{
+		FLAG_IS_STMT,
+		FLAG_BASIC_BLOCK,
+		FLAG_END_SEQUENCE,
+		FLAG_PROLOGUE_END,
+		FLAG_EPILOGUE_BEGIN,
+		FLAG_COUNT
+	};
+
+	struct Block
+	{
+		uint32_t address;
+		uint16_t line;
+		uint16_t file;
+		uint32_t offsets[COLUMN_COUNT];
+		uint64_t flags[FLAG_COUNT];
+	};
+
+	std::vector<Block> blocks_;
+	std::vector<uint8_t> columns_[COLUMN_COUNT];
+	uint64_t size_ = 0;
+
+public:
+	CompactLineTable() = default;
+	CompactLineTable(LineTable const &line_table);
+
+	size_t size() const { return size_; }
+
+	LineTableRow row(size_t index) const;
+
+	// Decode a whole block into rows, returning the number of rows in it.
+	size_t decode_block(size_t block, LineTableRow *rows) const;
+
+	// Bytes used by the rows, excluding the object itself.
+	size_t memory_usage() const;
+
+	void save(CacheWriter &writer) const;
+	bool load(CacheReader &reader);
+};
@@ -1,19 +1,22 @@
 #include <cstdint>
-#include <iomanip>
-#include <iostream>
+#include <cstdio>
+#include <string>
 
 #include "elf_file.h"
 #include "riscv-disassembler/src/riscv-disas.h"
 
-void print_instruction_range(size_t start, Span const &code) {
+void print_instruction_range(size_t start, Span const &code, std::string &out) {
 	char buffer[128];
+	char address[16];
 	for (size_t i = 0; i < code.size;) {
 		rv_inst inst;
 		size_t length;
 		inst_fetch(code.data + i, &inst, &length);
 		disasm_inst(buffer, sizeof(buffer), rv32, start + i, inst);
-		std::cout << std::hex << std::setw(8) << std::setfill('0') << (start + i) << ":  " <<
-			buffer << '\n';
+		snprintf(address, sizeof(address), "%08zx:  ", start + i);
+		out += address;
+		out += buffer;
+		out += '\n';
 		i += length;
 	}
 }
@@ -6,27 +6,35 @@
 #include <sys/types.h>
 #include <unistd.h>
 
+#include "../common/leb128.h"
+
 #include "dwarf.h"
 #include "elf_file.h"
 
-static uint8_t *skip_leb(uint8_t *cur) {
-	while (*cur & 0x80) {
-		cur += 1;
-	}
-	return cur + 1;
-}
-
 static uint64_t parse_uleb(uint8_t *&cur) {
-	uint64_t shift = 0;
-	uint64_t result = 0;
-	do {
-		result |= (uint64_t)*cur << shift;
-		shift += 7;
-		cur += 1;
-	} while (*cur & 0x80);
+	uint64_t result;
+	cur += decode_uleb(cur, result);
 	return result;
 }
 
+// Parse the (content type code, form code) pairs of a directory or file name entry format.
+static std::vector<std::pair<uint64_t, uint64_t>> parse_entry_format(uint8_t *&cur, uint8_t *end) {
+	uint8_t entry_format_count;
+	memcpy(&entry_format_count, cur, sizeof(entry_format_count));
+	cur += sizeof(entry_format_count);
+
+	uint64_t codes[2 * UINT8_MAX];
+	uint8_t const *codes_cur = cur;
+	size_t const codes_count = decode_uleb_run(codes_cur, end, codes, 2 * entry_format_count);
+	cur += codes_cur - cur;
+
+	std::vector<std::pair<uint64_t, uint64_t>> entry_format;
+	for (size_t i = 0; i + 1 < codes_count; i += 2) {
+		entry_format.push_back({ codes[i], codes[i + 1] });
+	}
+	return entry_format;
+}
+
 #define DW_FORM_data2     0x05
 #define DW_FORM_data4     0x06
 #define DW_FORM_data8     0x07
@@ -184,18 +192,48 @@ ElfFile::ElfFile(char const *file_name) {
 	const Span debug_line_str = get_section(".debug_line_str");
 
 	const Span debug_line = get_section(".debug_line");
+	uint8_t *const debug_line_end = debug_line.data + debug_line.size;
 	uint8_t *cur = debug_line.data;
+	while ((size_t)(debug_line_end - cur) >= sizeof(uint32_t)) {
+		uint32_t unit_length;
+		memcpy(&unit_length, cur, sizeof(unit_length));
+		cur += sizeof(unit_length);
+		// Lengths from 0xFFFFFFF0 up are escapes, such as the one for 64-bit DWARF.
+		if (unit_length >= 0xFFFFFFF0 || unit_length > (size_t)(debug_line_end - cur)) {
+			std::cerr << "invalid .debug_line unit length\n";
+			return;
+		}
+		uint8_t *const unit_end = cur + unit_length;
+		parse_line_program(cur, unit_end, debug_str, debug_line_str);
+		cur = unit_end;
+	}
+
+	if (line_programs_.empty()) {
+		std::cerr << "no line programs found\n";
+		return;
+	}
+
+	valid_ = true;
+}
 
-	uint32_t unit_length;
-	memcpy(&unit_length, cur, sizeof(unit_length));
-	cur += sizeof(unit_length);
-	uint8_t *line_table_program_end = cur + unit_length;
+// Parse the line program unit in [cur, line_table_program_end), following its unit_length, and add
+// it to line_programs_. A unit that isn't supported, such as one from an older DWARF version, is
+// reported and skipped, so the rest of the image can still be used.
+void ElfFile::parse_line_program(uint8_t *cur, uint8_t *line_table_program_end, Span const &debug_str,
+                                 Span const &debug_line_str) {
+	LineProgram line_program;
+
+	// version, address_size, segment_selector_size and header_length
+	if (line_table_program_end - cur < 8) {
+		std::cerr << "skipping a truncated line program\n";
+		return;
+	}
 
 	uint16_t version;
 	memcpy(&version, cur, sizeof(version));
 	cur += sizeof(version);
 	if (version != 5) {
-		std::cerr << "only dwarf v5 is supported\n";
+		std::cerr << "skipping a dwarf v" << version << " line program: only dwarf v5 is supported\n";
 		return;
 	}
 
@@ -205,31 +243,26 @@ ElfFile::ElfFile(char const *file_name) {
 	uint32_t header_length;
 	memcpy(&header_length, cur, sizeof(header_length));
 	cur += sizeof(header_length);
-	line_table_program_      = cur + header_length;
-	line_table_program_size_ = line_table_program_end - line_table_program_;
+	if (header_length > (size_t)(line_table_program_end - cur)) {
+		std::cerr << "skipping a line program with an invalid header length\n";
+		return;
+	}
+	line_program.program_code.data = cur + header_length;
+	line_program.program_code.size = line_table_program_end - line_program.program_code.data;
 
 	cur += sizeof(uint8_t); // skip minimum_instruction_length
 	cur += sizeof(uint8_t); // skip maximum_operations_per_instruction
 
 	uint8_t opcode_base;
-	memcpy(&program_header_, cur, sizeof(program_header_));
+	memcpy(&line_program.program_header, cur, sizeof(line_program.program_header));
 	memcpy(&opcode_base, cur + 3, sizeof(opcode_base));
-	cur += sizeof(program_header_);
+	cur += sizeof(line_program.program_header);
 
-	for (uint8_t i = 0; i < opcode_base - 1; ++i) {
-		cur = skip_leb(cur); // skip standard_opcode_lengths
+	if (opcode_base > 0) {
+		cur += opcode_base - 1; // skip standard_opcode_lengths
 	}
 
-	uint8_t directory_entry_format_count;
-	memcpy(&directory_entry_format_count, cur, sizeof(directory_entry_format_count));
-	cur += sizeof(directory_entry_format_count);
-
-	std::vector<std::pair<uint64_t, uint64_t>> directory_format;
-	for (uint8_t i = 0; i < directory_entry_format_count; ++i) {
-		uint64_t const content_type_code = parse_uleb(cur);
-		uint64_t const form_code = parse_uleb(cur);
-		directory_format.push_back({ content_type_code, form_code });
-	}
+	std::vector<std::pair<uint64_t, uint64_t>> const directory_format = parse_entry_format(cur, line_table_program_end);
 
 	const uint64_t directories_count = parse_uleb(cur);
 
@@ -255,7 +288,8 @@ ElfFile::ElfFile(char const *file_name) {
 					cur = skip_data16(cur);
 				} break;
 				default: {
-					std::cerr << "unknown content type code " << content_type_code << '\n';
+					std::cerr << "skipping a line program with unknown content type code " <<
+						content_type_code << '\n';
 					return;
 				}
 			}
@@ -263,16 +297,7 @@ ElfFile::ElfFile(char const *file_name) {
 		directories.push_back(dir);
 	}
 
-	uint8_t file_name_entry_format_count;
-	memcpy(&file_name_entry_format_count, cur, sizeof(file_name_entry_format_count));
-	cur += sizeof(file_name_entry_format_count);
-
-	std::vector<std::pair<uint64_t, uint64_t>> file_name_format;
-	for (uint8_t i = 0; i < file_name_entry_format_count; ++i) {
-		uint64_t const content_type_code = parse_uleb(cur);
-		uint64_t const form_code = parse_uleb(cur);
-		file_name_format.push_back({ content_type_code, form_code });
-	}
+	std::vector<std::pair<uint64_t, uint64_t>> const file_name_format = parse_entry_format(cur, line_table_program_end);
 
 	const uint64_t file_names_count = parse_uleb(cur);
 
@@ -298,15 +323,16 @@ ElfFile::ElfFile(char const *file_name) {
 					cur = skip_data16(cur);
 				} break;
 				default: {
-					std::cerr << "unknown content type code " << content_type_code << '\n';
+					std::cerr << "skipping a line program with unknown content type code " <<
+						content_type_code << '\n';
 					return;
 				}
 			}
 		}
-		file_names_.push_back(file_name);
+		line_program.file_names.push_back(file_name);
 	}
 
-	valid_ = true;
+	line_programs_.push_back(line_program);
 }
 
 ElfFile::~ElfFile() {
@@ -330,6 +356,26 @@ Span ElfFile::text(size_t start, size_t end) {
 	return { };
 }
 
+// FNV-1a, 64-bit.
+static uint64_t hash_bytes(uint64_t hash, uint8_t const *data, size_t size) {
+	for (size_t i = 0; i < size; ++i) {
+		hash ^= data[i];
+		hash *= 0x100000001B3;
+	}
+	return hash;
+}
+
+uint64_t ElfFile::line_info_hash() {
+	uint64_t hash = 0xCBF29CE484222325;
+	for (char const *section_name : { ".debug_line", ".debug_line_str", ".debug_str" }) {
+		Span const section = get_section(section_name);
+		uint64_t const size = section.size;
+		hash = hash_bytes(hash, (uint8_t const *)&size, sizeof(size));
+		hash = hash_bytes(hash, section.data, section.size);
+	}
+	return hash;
+}
+
 std::string ElfFile::get_string(size_t index) {
 	auto const *strtab = section_map_[".strtab"];
 	return std::string((char *)data_ + strtab->sh_offset + index);
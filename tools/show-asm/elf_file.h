@@ -13,6 +13,15 @@ struct Span
 	size_t size;
 };
 
+// A line number program unit from .debug_line, with its own header and file table. The file
+// names are indexed the same way as the program's file register.
+struct LineProgram
+{
+	uint32_t program_header;
+	Span program_code;
+	std::vector<std::string> file_names;
+};
+
 class ElfFile
 {
 	bool valid_;
@@ -22,10 +31,7 @@ class ElfFile
 	uint8_t *data_;
 	std::vector<Elf32_Shdr> section_headers_;
 	std::unordered_map<std::string, Elf32_Shdr const *> section_map_;
-	std::vector<std::string> file_names_;
-	uint8_t *line_table_program_;
-	size_t line_table_program_size_;
-	uint32_t program_header_;
+	std::vector<LineProgram> line_programs_;
 
 public:
 	ElfFile(char const *file_name);
@@ -33,13 +39,21 @@ public:
 
 	bool valid() const { return valid_; }
 
-	std::vector<std::string> const &file_names() { return file_names_; }
-	uint32_t program_header() { return program_header_; }
-	Span program_code() { return { line_table_program_, line_table_program_size_ }; }
+	std::vector<LineProgram> const &line_programs() const { return line_programs_; }
+
+	// The header, code, and file names of the first unit.
+	std::vector<std::string> const &file_names() { return line_programs_[0].file_names; }
+	uint32_t program_header() { return line_programs_[0].program_header; }
+	Span program_code() { return line_programs_[0].program_code; }
 	Span text(size_t start, size_t end);
 
+	// A hash of every section the line tables are built from, to detect stale caches.
+	uint64_t line_info_hash();
+
 private:
 	std::string get_string(size_t index);
 	std::string get_section_name(size_t index);
 	Span get_section(std::string const &section_name);
+	void parse_line_program(uint8_t *cur, uint8_t *line_table_program_end, Span const &debug_str,
+	                        Span const &debug_line_str);
 };
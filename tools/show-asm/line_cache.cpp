@@ -0,0 +1,92 @@
+#include <cstdio>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "line_cache.h"
+
+#define LINE_CACHE_MAGIC 0x434C5744 // "DWLC"
+
+bool read_line_cache(std::string const &cache_file_name, LineCacheKey const &key, CompactLineTable &rows,
+                     std::vector<std::string> &file_names, AddressIndex &address_index, SourceIndex &source_index) {
+	int const fd = open(cache_file_name.c_str(), O_RDONLY);
+	if (fd < 0) {
+		return false;
+	}
+
+	struct stat stats;
+	if (fstat(fd, &stats) < 0 || stats.st_size == 0) {
+		close(fd);
+		return false;
+	}
+	size_t const size = stats.st_size;
+
+	void *const data = mmap(0, size, PROT_READ, MAP_SHARED, fd, 0);
+	close(fd);
+	if (data == MAP_FAILED) {
+		return false;
+	}
+
+	CacheReader reader { (uint8_t const *)data, size };
+
+	uint32_t magic;
+	uint32_t version;
+	LineCacheKey cache_key;
+	bool valid = reader.read(magic) && magic == LINE_CACHE_MAGIC &&
+	             reader.read(version) && version == LINE_CACHE_VERSION &&
+	             reader.read(cache_key.line_info_hash) && cache_key.line_info_hash == key.line_info_hash &&
+	             reader.read(cache_key.decoder) && cache_key.decoder == key.decoder &&
+	             reader.read(cache_key.decoder_version) && cache_key.decoder_version == key.decoder_version;
+
+	if (valid) {
+		std::vector<char> file_name_block;
+		valid = rows.load(reader) && reader.read_array(file_name_block) &&
+		        (file_name_block.empty() || file_name_block.back() == '\0');
+		file_names.clear();
+		for (size_t start = 0; valid && start < file_name_block.size();) {
+			file_names.push_back(file_name_block.data() + start);
+			start += file_names.back().size() + 1;
+		}
+		valid = valid && address_index.load(reader, rows.size()) && source_index.load(reader) && reader.ok() &&
+		        reader.at_end();
+	}
+
+	munmap(data, size);
+
+	return valid;
+}
+
+bool write_line_cache(std::string const &cache_file_name, LineCacheKey const &key, CompactLineTable const &rows,
+                      std::vector<std::string> const &file_names, AddressIndex const &address_index,
+                      SourceIndex const &source_index) {
+	CacheWriter writer;
+	writer.write<uint32_t>(LINE_CACHE_MAGIC);
+	writer.write<uint32_t>(LINE_CACHE_VERSION);
+	writer.write<uint64_t>(key.line_info_hash);
+	writer.write<uint32_t>(key.decoder);
+	writer.write<uint32_t>(key.decoder_version);
+
+	// File names are stored as one block of nul-terminated strings.
+	std::vector<char> file_name_block;
+	for (std::string const &file_name : file_names) {
+		file_name_block.insert(file_name_block.end(), file_name.c_str(), file_name.c_str() + file_name.size() + 1);
+	}
+	rows.save(writer);
+	writer.write_array(file_name_block);
+	address_index.save(writer);
+	source_index.save(writer);
+
+	std::string const temp_file_name = cache_file_name + ".tmp." + std::to_string(getpid());
+	FILE *file = fopen(temp_file_name.c_str(), "wb");
+	if (!file) {
+		return false;
+	}
+	bool const written = fwrite(writer.data().data(), 1, writer.data().size(), file) == writer.data().size();
+	if (fclose(file) != 0 || !written || rename(temp_file_name.c_str(), cache_file_name.c_str()) != 0) {
+		remove(temp_file_name.c_str());
+		return false;
+	}
+
+	return true;
+}
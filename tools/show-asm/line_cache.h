@@ -0,0 +1,98 @@
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+#include "compact_line_table.h"
+#include "line_index.h"
+
+// Bump whenever the layout of the cache, or of anything stored in it, changes. The header also
+// holds the decoder and its version, so rows decoded by the other decoder, or by another revision
+// of the RTL or the software decoder, are treated as misses too.
+#define LINE_CACHE_VERSION 3
+
+// Serialises plain data and arrays of plain data into a byte buffer.
+class CacheWriter
+{
+	std::vector<uint8_t> data_;
+
+public:
+	std::vector<uint8_t> const &data() const { return data_; }
+
+	template <typename T>
+	void write(T const &value) {
+		static_assert(std::is_trivially_copyable<T>::value, "cache values must be trivially copyable");
+		uint8_t const *bytes = (uint8_t const *)&value;
+		data_.insert(data_.end(), bytes, bytes + sizeof(value));
+	}
+
+	template <typename T>
+	void write_array(std::vector<T> const &values) {
+		static_assert(std::is_trivially_copyable<T>::value, "cache values must be trivially copyable");
+		write<uint64_t>(values.size());
+		uint8_t const *bytes = (uint8_t const *)values.data();
+		data_.insert(data_.end(), bytes, bytes + values.size() * sizeof(T));
+	}
+};
+
+// Reads back what a CacheWriter wrote. Reads past the end of the buffer fail, and leave the reader
+// failed, so a truncated cache is detected once at the end instead of after every read.
+class CacheReader
+{
+	uint8_t const *cur_;
+	uint8_t const *end_;
+	bool ok_;
+
+public:
+	CacheReader(uint8_t const *data, size_t size) : cur_(data), end_(data + size), ok_(true) { }
+
+	bool ok() const { return ok_; }
+	bool at_end() const { return cur_ == end_; }
+
+	template <typename T>
+	bool read(T &value) {
+		if (!ok_ || (size_t)(end_ - cur_) < sizeof(value)) {
+			ok_ = false;
+			return false;
+		}
+		memcpy(&value, cur_, sizeof(value));
+		cur_ += sizeof(value);
+		return true;
+	}
+
+	template <typename T>
+	bool read_array(std::vector<T> &values) {
+		uint64_t size;
+		if (!read(size) || size > (size_t)(end_ - cur_) / sizeof(T)) {
+			ok_ = false;
+			return false;
+		}
+		values.resize(size);
+		memcpy(values.data(), cur_, size * sizeof(T));
+		cur_ += size * sizeof(T);
+		return true;
+	}
+};
+
+// Identifies the line information a cache holds, and the decoder that produced it.
+struct LineCacheKey
+{
+	uint64_t line_info_hash;
+	uint32_t decoder;         // a Decoder
+	uint32_t decoder_version; // as returned by decoder_version()
+};
+
+// Load the line table and indexes from the cache file, returning false if it is missing, was
+// written by a different version, or is stale because key does not match. The arrays are bulk
+// copied out of the mapped file rather than used in place.
+bool read_line_cache(std::string const &cache_file_name, LineCacheKey const &key, CompactLineTable &rows,
+                     std::vector<std::string> &file_names, AddressIndex &address_index, SourceIndex &source_index);
+
+// Write the line table and indexes to the cache file. The file is written under a temporary name
+// and renamed into place, so a concurrent reader never sees it partially written.
+bool write_line_cache(std::string const &cache_file_name, LineCacheKey const &key, CompactLineTable const &rows,
+                      std::vector<std::string> const &file_names, AddressIndex const &address_index,
+                      SourceIndex const &source_index);
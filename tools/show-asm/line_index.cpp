@@ -0,0 +1,215 @@
+#include <algorithm>
+
+#include "line_cache.h"
+#include "line_index.h"
+
+AddressIndex::AddressIndex(LineTable const &line_table) {
+	// A row's interval ends at the next row in the same sequence. Rows at the same address leave
+	// an empty interval for all but the last of them, which is the one that describes the address.
+	std::vector<uint32_t> order;
+	for (size_t i = 0; i + 1 < line_table.size(); ++i) {
+		if (!line_table[i].end_sequence && line_table[i].address < line_table[i + 1].address) {
+			order.push_back(i);
+		}
+	}
+
+	// Sequences are usually emitted in address order already, in which case this is a single pass.
+	std::stable_sort(order.begin(), order.end(), [&](uint32_t a, uint32_t b) {
+		return line_table[a].address < line_table[b].address;
+	});
+
+	// Intervals only overlap when sequences do, such as those of functions the linker discarded and
+	// relocated to 0. Clip each interval to the addresses not already covered, so the intervals are
+	// disjoint and a short interval can't hide a longer one that starts before it. Where intervals
+	// overlap, the one that starts first keeps the shared addresses.
+	starts_.reserve(order.size());
+	ends_.reserve(order.size());
+	rows_.reserve(order.size());
+	for (uint32_t const row : order) {
+		uint32_t start     = line_table[row].address;
+		uint32_t const end = line_table[row + 1].address;
+		if (!ends_.empty() && start < ends_.back()) {
+			start = ends_.back();
+		}
+		if (start < end) {
+			starts_.push_back(start);
+			ends_.push_back(end);
+			rows_.push_back(row);
+		}
+	}
+}
+
+bool AddressIndex::lookup(uint32_t address, size_t &row) const {
+	auto const next = std::upper_bound(starts_.begin(), starts_.end(), address);
+	if (next == starts_.begin()) {
+		return false;
+	}
+	size_t const i = (next - starts_.begin()) - 1;
+	if (address >= ends_[i]) {
+		return false;
+	}
+	row = rows_[i];
+	return true;
+}
+
+void AddressIndex::save(CacheWriter &writer) const {
+	writer.write_array(starts_);
+	writer.write_array(ends_);
+	writer.write_array(rows_);
+}
+
+bool AddressIndex::load(CacheReader &reader, size_t num_rows) {
+	if (!reader.read_array(starts_) || !reader.read_array(ends_) || !reader.read_array(rows_) ||
+	    starts_.size() != ends_.size() || starts_.size() != rows_.size()) {
+		return false;
+	}
+	for (uint32_t const row : rows_) {
+		if (row >= num_rows) {
+			return false;
+		}
+	}
+	return true;
+}
+
+SourceIndex::SourceIndex(LineTable const &line_table) {
+	struct KeyedRange
+	{
+		uint32_t key;
+		AddressRange range;
+	};
+
+	// A range starts at a row and runs until the next row for a different line, or the end of
+	// the sequence.
+	std::vector<KeyedRange> keyed_ranges;
+	bool in_range = false;
+	for (LineTableRow const &row : line_table) {
+		uint32_t const key = ((uint32_t)row.file << 16) | row.line;
+		if (in_range && (row.end_sequence || key != keyed_ranges.back().key)) {
+			keyed_ranges.back().range.end = row.address;
+			in_range = false;
+		}
+		if (!in_range && !row.end_sequence) {
+			keyed_ranges.push_back({ key, { row.address, row.address } });
+			in_range = true;
+		}
+	}
+	if (in_range) {
+		keyed_ranges.pop_back();
+	}
+
+	std::sort(keyed_ranges.begin(), keyed_ranges.end(), [](KeyedRange const &a, KeyedRange const &b) {
+		return a.key < b.key || (a.key == b.key && a.range.start < b.range.start);
+	});
+
+	// Merge touching and overlapping ranges for the same line.
+	std::vector<Slot> lines;
+	for (KeyedRange const &keyed_range : keyed_ranges) {
+		if (keyed_range.range.start == keyed_range.range.end) {
+			continue;
+		}
+		if (lines.empty() || lines.back().key != keyed_range.key) {
+			lines.push_back({ keyed_range.key, (uint32_t)ranges_.size(), 1 });
+			ranges_.push_back(keyed_range.range);
+		} else if (keyed_range.range.start <= ranges_.back().end) {
+			ranges_.back().end = std::max(ranges_.back().end, keyed_range.range.end);
+		} else {
+			lines.back().count += 1;
+			ranges_.push_back(keyed_range.range);
+		}
+	}
+
+	slot_shift_ = 28;
+	while ((1u << (32 - slot_shift_)) < lines.size() * 2) {
+		slot_shift_ -= 1;
+	}
+	slots_.resize(1u << (32 - slot_shift_), { 0, 0, 0 });
+
+	uint32_t const num_files = lines.empty() ? 0 : (lines.back().key >> 16) + 1;
+	line_bitmap_offsets_.resize(num_files, 0);
+	line_bitmap_sizes_.resize(num_files, 0);
+	for (Slot const &line : lines) {
+		uint32_t const file = line.key >> 16;
+		line_bitmap_sizes_[file] = ((line.key & 0xFFFF) / 64) + 1;
+	}
+	uint32_t line_bitmap_words = 0;
+	for (uint32_t file = 0; file < num_files; ++file) {
+		line_bitmap_offsets_[file] = line_bitmap_words;
+		line_bitmap_words         += line_bitmap_sizes_[file];
+	}
+	line_bitmaps_.resize(line_bitmap_words, 0);
+
+	for (Slot const &line : lines) {
+		slots_[slot_index(line.key)] = line;
+
+		uint32_t const file   = line.key >> 16;
+		uint32_t const number = line.key & 0xFFFF;
+		line_bitmaps_[line_bitmap_offsets_[file] + number / 64] |= (uint64_t)1 << (number % 64);
+	}
+}
+
+bool SourceIndex::has_line(uint16_t file, uint16_t line) const {
+	if (file >= line_bitmap_sizes_.size() || line / 64u >= line_bitmap_sizes_[file]) {
+		return false;
+	}
+	return ((line_bitmaps_[line_bitmap_offsets_[file] + line / 64] >> (line % 64)) & 1) == 1;
+}
+
+bool SourceIndex::lookup(uint16_t file, uint16_t line, AddressRange const *&ranges, size_t &count) const {
+	if (!has_line(file, line)) {
+		return false;
+	}
+	Slot const &slot = slots_[slot_index(((uint32_t)file << 16) | line)];
+	ranges = ranges_.data() + slot.first;
+	count  = slot.count;
+	return count != 0;
+}
+
+void SourceIndex::save(CacheWriter &writer) const {
+	writer.write_array(slots_);
+	writer.write(slot_shift_);
+	writer.write_array(ranges_);
+	writer.write_array(line_bitmaps_);
+	writer.write_array(line_bitmap_offsets_);
+	writer.write_array(line_bitmap_sizes_);
+}
+
+bool SourceIndex::load(CacheReader &reader) {
+	if (!reader.read_array(slots_) || !reader.read(slot_shift_) || !reader.read_array(ranges_) ||
+	    !reader.read_array(line_bitmaps_) || !reader.read_array(line_bitmap_offsets_) ||
+	    !reader.read_array(line_bitmap_sizes_)) {
+		return false;
+	}
+
+	// Check everything lookups index with, so a corrupt cache is rejected rather than trusted.
+	if (slot_shift_ < 1 || slot_shift_ > 28 || slots_.size() != (size_t)1 << (32 - slot_shift_) ||
+	    line_bitmap_offsets_.size() != line_bitmap_sizes_.size()) {
+		return false;
+	}
+	for (Slot const &slot : slots_) {
+		if ((uint64_t)slot.first + slot.count > ranges_.size()) {
+			return false;
+		}
+	}
+	for (AddressRange const &range : ranges_) {
+		if (range.start > range.end) {
+			return false;
+		}
+	}
+	for (size_t file = 0; file < line_bitmap_sizes_.size(); ++file) {
+		if ((uint64_t)line_bitmap_offsets_[file] + line_bitmap_sizes_[file] > line_bitmaps_.size()) {
+			return false;
+		}
+	}
+	return true;
+}
+
+// Linear probing from a multiplicative hash of the key. Returns the slot holding key, or the empty
+// slot where it would be inserted.
+size_t SourceIndex::slot_index(uint32_t key) const {
+	size_t const mask = slots_.size() - 1;
+	size_t i = (key * 0x9E3779B1u) >> slot_shift_;
+	while (slots_[i].count != 0 && slots_[i].key != key) {
+		i = (i + 1) & mask;
+	}
+	return i;
+}
@@ -0,0 +1,71 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include "../common/line_table.h"
+
+class CacheReader;
+class CacheWriter;
+
+// Maps addresses to the row of the line table that covers them. Each row other than an end
+// sequence covers the addresses up to the next row in its sequence, so the index is a sorted list
+// of [start, end) intervals, searched by binary search.
+class AddressIndex
+{
+	std::vector<uint32_t> starts_;
+	std::vector<uint32_t> ends_;
+	std::vector<uint32_t> rows_;
+
+public:
+	AddressIndex() = default;
+	AddressIndex(LineTable const &line_table);
+
+	// Find the index of the row covering address, returning false if no row does.
+	bool lookup(uint32_t address, size_t &row) const;
+
+	void save(CacheWriter &writer) const;
+	bool load(CacheReader &reader, size_t num_rows);
+};
+
+struct AddressRange
+{
+	uint32_t start;
+	uint32_t end;
+};
+
+// Maps (file, line) pairs to the merged address ranges generated for them. Ranges for all pairs
+// are stored in one array, referenced from an open addressing hash table, and a bitmap of the
+// lines each file has rows for lets misses return without probing the table.
+class SourceIndex
+{
+	struct Slot
+	{
+		uint32_t key;   // file << 16 | line
+		uint32_t first; // index of the first range in ranges_
+		uint32_t count; // number of ranges, 0 for an empty slot
+	};
+
+	std::vector<Slot> slots_;
+	uint32_t slot_shift_; // 32 - log2 of the number of slots
+	std::vector<AddressRange> ranges_;
+	std::vector<uint64_t> line_bitmaps_;
+	std::vector<uint32_t> line_bitmap_offsets_; // per file, into line_bitmaps_
+	std::vector<uint32_t> line_bitmap_sizes_;   // per file, in words
+
+public:
+	SourceIndex() = default;
+	SourceIndex(LineTable const &line_table);
+
+	// Find the address ranges for line of file, returning false if there are none.
+	bool lookup(uint16_t file, uint16_t line, AddressRange const *&ranges, size_t &count) const;
+
+	// Whether file has any rows for line.
+	bool has_line(uint16_t file, uint16_t line) const;
+
+	void save(CacheWriter &writer) const;
+	bool load(CacheReader &reader);
+
+private:
+	size_t slot_index(uint32_t key) const;
+};
@@ -0,0 +1,95 @@
+#include <algorithm>
+#include <atomic>
+#include <memory>
+#include <thread>
+#include <unordered_map>
+
+#include "../common/line_decoder.h"
+
+#include "line_loader.h"
+#include "sim.h"
+
+// Decode units until there are none left. Each worker owns its own model or decoder, so the only
+// shared state is the index of the next unit.
+static void decode_worker(std::vector<LineProgram> const &line_programs, Decoder decoder,
+                          std::atomic<size_t> &next_unit, std::vector<LineTable> &unit_rows) {
+	std::unique_ptr<Sim> sim;
+	if (decoder == DECODER_HARDWARE) {
+		sim = std::make_unique<Sim>();
+		sim->set_write_pacing(WRITE_PACING_ADAPTIVE, FIXED_WRITE_PACING_CYCLES);
+		sim->set_status_wait(STATUS_WAIT_INTERRUPT);
+	}
+
+	size_t unit;
+	while ((unit = next_unit.fetch_add(1)) < line_programs.size()) {
+		LineProgram const &line_program = line_programs[unit];
+		Span const &program_code = line_program.program_code;
+		if (sim) {
+			unit_rows[unit] = sim->run_program(line_program.program_header, program_code.data, program_code.size);
+		} else {
+			LineDecoder const line_decoder { line_program.program_header };
+			if (!line_decoder.decode(program_code.data, program_code.size, unit_rows[unit])) {
+				unit_rows[unit].clear();
+			}
+		}
+	}
+}
+
+void merge_file_names(std::vector<LineProgram> const &line_programs, std::vector<std::string> &file_names,
+                      std::vector<std::vector<uint16_t>> &file_maps) {
+	file_names.assign(1, "");
+	file_maps.assign(line_programs.size(), { });
+
+	std::unordered_map<std::string, uint16_t> file_indices;
+	for (size_t unit = 0; unit < line_programs.size(); ++unit) {
+		for (std::string const &file_name : line_programs[unit].file_names) {
+			auto const [it, inserted] = file_indices.insert({ file_name, (uint16_t)file_names.size() });
+			if (inserted) {
+				file_names.push_back(file_name);
+			}
+			file_maps[unit].push_back(it->second);
+		}
+	}
+}
+
+uint32_t decoder_version(Decoder decoder) {
+	if (decoder == DECODER_HARDWARE) {
+		return Sim().read_info();
+	}
+	return LINE_DECODER_VERSION;
+}
+
+LoadedLineTable load_line_table(ElfFile const &elf_file, Decoder decoder, unsigned num_jobs) {
+	std::vector<LineProgram> const &line_programs = elf_file.line_programs();
+	std::vector<LineTable> unit_rows(line_programs.size());
+
+	std::atomic<size_t> next_unit { 0 };
+	num_jobs = std::max(1u, std::min<unsigned>(num_jobs, line_programs.size()));
+	std::vector<std::thread> workers;
+	for (unsigned i = 1; i < num_jobs; ++i) {
+		workers.emplace_back(decode_worker, std::cref(line_programs), decoder, std::ref(next_unit), std::ref(unit_rows));
+	}
+	decode_worker(line_programs, decoder, next_unit, unit_rows);
+	for (std::thread &worker : workers) {
+		worker.join();
+	}
+
+	LoadedLineTable loaded;
+	std::vector<std::vector<uint16_t>> file_maps;
+	merge_file_names(line_programs, loaded.file_names, file_maps);
+
+	size_t num_rows = 0;
+	for (LineTable const &rows : unit_rows) {
+		num_rows += rows.size();
+	}
+	loaded.rows.reserve(num_rows);
+
+	for (size_t unit = 0; unit < line_programs.size(); ++unit) {
+		for (LineTableRow row : unit_rows[unit]) {
+			row.file = map_file(file_maps[unit], row.file);
+			loaded.rows.push_back(row);
+		}
+	}
+
+	return loaded;
+}
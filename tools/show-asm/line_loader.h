@@ -0,0 +1,40 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include "../common/line_table.h"
+
+#include "elf_file.h"
+
+enum Decoder
+{
+	DECODER_HARDWARE, // the Verilator model of the accelerator
+	DECODER_SOFTWARE, // the software decoder
+};
+
+// The rows of every line program unit in an ELF file, with file indices remapped into a single
+// deduplicated list of file names. File index 0 is unused, as in the accelerator.
+struct LoadedLineTable
+{
+	LineTable rows;
+	std::vector<std::string> file_names;
+};
+
+// Merge the file tables of every unit into one deduplicated list of file names, starting with the
+// unused entry 0, and map each unit's file indices into it.
+void merge_file_names(std::vector<LineProgram> const &line_programs, std::vector<std::string> &file_names,
+                      std::vector<std::vector<uint16_t>> &file_maps);
+
+// Map a unit's file index into the merged list. Indices the unit has no name for map to 0.
+inline uint16_t map_file(std::vector<uint16_t> const &file_map, uint16_t file) {
+	return file < file_map.size() ? file_map[file] : 0;
+}
+
+// The version of the rows the decoder produces: the accelerator's INFO register for the hardware
+// decoder, and LINE_DECODER_VERSION for the software one.
+uint32_t decoder_version(Decoder decoder);
+
+// Decode every unit of the ELF file, spread over num_jobs worker threads. Units containing
+// illegal instructions contribute no rows.
+LoadedLineTable load_line_table(ElfFile const &elf_file, Decoder decoder, unsigned num_jobs);
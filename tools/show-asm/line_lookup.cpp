@@ -0,0 +1,289 @@
+#include <algorithm>
+#include <iostream>
+
+#include "line_cache.h"
+#include "line_lookup.h"
+
+EagerLineLookup::EagerLineLookup(ElfFile &elf_file, char const *elf_file_name, Decoder decoder, unsigned num_jobs,
+                                 bool use_cache) {
+	// The cache is keyed on the debug sections rather than the whole file, so rebuilding the code
+	// without changing its line information keeps the cache valid.
+	std::string const cache_file_name = std::string(elf_file_name) + ".lines";
+	LineCacheKey const cache_key = { elf_file.line_info_hash(), decoder, decoder_version(decoder) };
+
+	if (!use_cache || !read_line_cache(cache_file_name, cache_key, rows, file_names_, address_index, source_index)) {
+		LoadedLineTable loaded = load_line_table(elf_file, decoder, num_jobs);
+		address_index = AddressIndex { loaded.rows };
+		source_index  = SourceIndex { loaded.rows };
+		rows          = CompactLineTable { loaded.rows };
+		file_names_   = std::move(loaded.file_names);
+		if (use_cache && !write_line_cache(cache_file_name, cache_key, rows, file_names_, address_index, source_index)) {
+			std::cerr << "failed to write cache file " << cache_file_name << '\n';
+		}
+	}
+}
+
+std::vector<std::string> const &EagerLineLookup::file_names() {
+	return file_names_;
+}
+
+bool EagerLineLookup::lookup_address(uint32_t address, LineTableRow &row) {
+	size_t row_index;
+	if (!address_index.lookup(address, row_index)) {
+		return false;
+	}
+	row = rows.row(row_index);
+	return true;
+}
+
+void EagerLineLookup::lookup_line(uint16_t file, uint16_t line, std::vector<AddressRange> &ranges) {
+	AddressRange const *found;
+	size_t num_found;
+	ranges.clear();
+	if (source_index.lookup(file, line, found, num_found)) {
+		ranges.assign(found, found + num_found);
+	}
+}
+
+LazyLineLookup::LazyLineLookup(ElfFile &elf_file, Decoder decoder_in)
+	: line_programs(elf_file.line_programs()), decoder(decoder_in) {
+	merge_file_names(line_programs, file_names_, file_maps);
+
+	// Scan every unit, keeping the extent of each sequence and the files it refers to.
+	std::vector<SequenceInfo> infos;
+	std::vector<uint16_t> files;
+	std::vector<uint32_t> units;
+	for (size_t unit = 0; unit < line_programs.size(); ++unit) {
+		LineProgram const &line_program = line_programs[unit];
+		LineDecoder const line_decoder { line_program.program_header };
+
+		size_t const first_file = files.size();
+		line_decoder.scan(line_program.program_code.data, line_program.program_code.size, infos, files);
+		units.resize(infos.size(), unit);
+		for (size_t i = first_file; i < files.size(); ++i) {
+			files[i] = map_file(file_maps[unit], files[i]);
+		}
+	}
+
+	std::vector<uint32_t> order(infos.size());
+	for (uint32_t i = 0; i < order.size(); ++i) {
+		order[i] = i;
+	}
+	std::stable_sort(order.begin(), order.end(), [&](uint32_t a, uint32_t b) {
+		return infos[a].start_address < infos[b].start_address;
+	});
+
+	// Group the sorted sequence indices by file.
+	std::vector<std::vector<uint32_t>> files_sequences(file_names_.size());
+	for (uint32_t i = 0; i < order.size(); ++i) {
+		SequenceInfo const &info = infos[order[i]];
+		uint32_t const max_end_address = std::max(info.end_address, i > 0 ? sequences.back().max_end_address : 0);
+		sequences.push_back({ units[order[i]], info.offset, info.size, info.start_address, info.end_address,
+		                      max_end_address });
+		for (uint32_t file = info.files_first; file < info.files_first + info.files_count; ++file) {
+			files_sequences[files[file]].push_back(i);
+		}
+	}
+	for (std::vector<uint32_t> const &file : files_sequences) {
+		file_sequences_first.push_back(file_sequences.size());
+		file_sequences.insert(file_sequences.end(), file.begin(), file.end());
+	}
+	file_sequences_first.push_back(file_sequences.size());
+
+	decoded.resize(sequences.size());
+	filtered.resize(sequences.size());
+}
+
+// Compare against a LineTable holding the same rows, which is how the rows were stored before.
+static void report_row_memory(std::ostream &out, size_t num_rows, size_t bytes) {
+	size_t const line_table_bytes = num_rows * sizeof(LineTableRow);
+	out << "rows: " << num_rows << '\n';
+	out << "compact: " << bytes << " bytes, " << (num_rows ? (double)bytes / num_rows : 0.0) << " bytes/row\n";
+	out << "LineTable: " << line_table_bytes << " bytes, " << sizeof(LineTableRow) << " bytes/row\n";
+}
+
+void EagerLineLookup::report_memory(std::ostream &out) {
+	report_row_memory(out, rows.size(), rows.memory_usage());
+}
+
+std::vector<std::string> const &LazyLineLookup::file_names() {
+	return file_names_;
+}
+
+bool LazyLineLookup::lookup_address(uint32_t address, LineTableRow &row) {
+	auto const next = std::upper_bound(sequences.begin(), sequences.end(), address,
+		[](uint32_t address, Sequence const &sequence) { return address < sequence.start_address; });
+
+	// Sequences overlap when the linker discards functions and relocates them to 0, so every
+	// sequence covering the address is searched, walking back until no earlier sequence reaches
+	// it. As in AddressIndex, the covering row that starts first wins, and rows starting at the
+	// same address are taken in unit and program order.
+	Sequence const *found = nullptr;
+	for (size_t i = next - sequences.begin(); i > 0 && address < sequences[i - 1].max_end_address; --i) {
+		Sequence const &sequence = sequences[i - 1];
+		if (address >= sequence.end_address) {
+			continue;
+		}
+
+		// Rows within a sequence are in address order, so the covering row is the last one at or
+		// below the address.
+		LineTable const &rows = address_rows(i - 1, address);
+		auto const next_row = std::upper_bound(rows.begin(), rows.end(), address,
+			[](uint32_t address, LineTableRow const &row) { return address < row.address; });
+		if (next_row == rows.begin() || (next_row - 1)->end_sequence) {
+			continue;
+		}
+		LineTableRow const &candidate = *(next_row - 1);
+		if (!found || candidate.address < row.address ||
+			(candidate.address == row.address && (sequence.unit < found->unit ||
+			                                      (sequence.unit == found->unit && sequence.offset < found->offset)))) {
+			row   = candidate;
+			found = &sequence;
+		}
+	}
+	return found != nullptr;
+}
+
+void LazyLineLookup::lookup_line(uint16_t file, uint16_t line, std::vector<AddressRange> &ranges) {
+	ranges.clear();
+	if (file + 1u >= file_sequences_first.size()) {
+		return;
+	}
+
+	// Ranges are found the same way as SourceIndex, one sequence at a time.
+	for (uint32_t i = file_sequences_first[file]; i < file_sequences_first[file + 1]; ++i) {
+		LineTable const &rows = sequence_rows(file_sequences[i]);
+		bool in_range = false;
+		for (LineTableRow const &row : rows) {
+			bool const matches = row.file == file && row.line == line && !row.end_sequence;
+			if (in_range && !matches) {
+				ranges.back().end = row.address;
+				in_range = false;
+			}
+			if (!in_range && matches) {
+				ranges.push_back({ row.address, row.address });
+				in_range = true;
+			}
+		}
+		if (in_range) {
+			ranges.pop_back();
+		}
+	}
+
+	std::sort(ranges.begin(), ranges.end(), [](AddressRange const &a, AddressRange const &b) {
+		return a.start < b.start;
+	});
+	size_t num_merged = 0;
+	for (AddressRange const &range : ranges) {
+		if (range.start == range.end) {
+			continue;
+		}
+		if (num_merged > 0 && range.start <= ranges[num_merged - 1].end) {
+			ranges[num_merged - 1].end = std::max(ranges[num_merged - 1].end, range.end);
+		} else {
+			ranges[num_merged++] = range;
+		}
+	}
+	ranges.resize(num_merged);
+}
+
+void LazyLineLookup::report_memory(std::ostream &out) {
+	size_t num_decoded = 0;
+	size_t num_rows    = 0;
+	size_t bytes       = 0;
+	for (std::unique_ptr<LineTable> const &rows : decoded) {
+		if (rows) {
+			num_decoded += 1;
+			num_rows    += rows->size();
+			bytes       += rows->capacity() * sizeof(LineTableRow);
+		}
+	}
+	size_t num_filtered = 0;
+	for (std::unique_ptr<FilteredRows> const &filtered_rows : filtered) {
+		if (filtered_rows) {
+			num_filtered += 1;
+			num_rows     += filtered_rows->rows.size();
+			bytes        += filtered_rows->rows.capacity() * sizeof(LineTableRow);
+		}
+	}
+	out << "sequences decoded: " << num_decoded << " of " << sequences.size() << '\n';
+	out << "sequences filtered: " << num_filtered << '\n';
+	out << "rows: " << num_rows << ", " << bytes << " bytes\n";
+}
+
+Sim &LazyLineLookup::hardware_sim() {
+	if (!sim) {
+		sim = std::make_unique<Sim>();
+		sim->set_write_pacing(WRITE_PACING_ADAPTIVE, FIXED_WRITE_PACING_CYCLES);
+		sim->set_status_wait(STATUS_WAIT_INTERRUPT);
+	}
+	return *sim;
+}
+
+LineTable const &LazyLineLookup::sequence_rows(uint32_t sequence_index) {
+	if (decoded[sequence_index]) {
+		return *decoded[sequence_index];
+	}
+
+	Sequence const &sequence = sequences[sequence_index];
+	LineProgram const &line_program = line_programs[sequence.unit];
+	uint8_t *const program_code = line_program.program_code.data + sequence.offset;
+
+	// Every sequence starts from the initial state, so it decodes the same on its own as it does
+	// as part of the whole program.
+	auto rows = std::make_unique<LineTable>();
+	if (decoder == DECODER_HARDWARE) {
+		*rows = hardware_sim().run_program(line_program.program_header, program_code, sequence.size);
+	} else {
+		LineDecoder const line_decoder { line_program.program_header };
+		line_decoder.decode(program_code, sequence.size, *rows);
+	}
+	for (LineTableRow &row : *rows) {
+		row.file = map_file(file_maps[sequence.unit], row.file);
+	}
+
+	decoded[sequence_index] = std::move(rows);
+	return *decoded[sequence_index];
+}
+
+// The rows of a sequence to search for an address. With the hardware decoder, a sequence that
+// hasn't been decoded yet is run with the row filter set to the address, so only the few rows
+// around it are read back, rather than decoding and keeping the whole sequence for a single query.
+// The filtered rows are kept for repeated queries of the same address. Once a second address in
+// the sequence is queried, the whole sequence is decoded instead, so each sequence runs through
+// the hardware at most twice.
+LineTable const &LazyLineLookup::address_rows(uint32_t sequence_index, uint32_t address) {
+	if (decoder != DECODER_HARDWARE || decoded[sequence_index]) {
+		return sequence_rows(sequence_index);
+	}
+
+	std::unique_ptr<FilteredRows> &filtered_rows = filtered[sequence_index];
+	if (!filtered_rows) {
+		filtered_rows = std::make_unique<FilteredRows>();
+		filtered_rows->address = address;
+		filtered_rows->rows    = filtered_sequence_rows(sequence_index, address);
+	} else if (filtered_rows->address != address) {
+		filtered_rows.reset();
+		return sequence_rows(sequence_index);
+	}
+	return filtered_rows->rows;
+}
+
+// Decode a sequence with the hardware decoder, only reading back the rows that cover the address.
+// The filter also passes the row before the address, which is the covering row if no row starts
+// exactly at the address.
+LineTable LazyLineLookup::filtered_sequence_rows(uint32_t sequence_index, uint32_t address) {
+	Sequence const &sequence = sequences[sequence_index];
+	LineProgram const &line_program = line_programs[sequence.unit];
+	uint8_t *const program_code = line_program.program_code.data + sequence.offset;
+
+	Sim &hw = hardware_sim();
+	hw.set_row_filter(address, address + 1, FILTER_CTRL_ADDRESS);
+	LineTable rows = hw.run_program(line_program.program_header, program_code, sequence.size);
+	hw.set_row_filter(0, 0, 0);
+
+	for (LineTableRow &row : rows) {
+		row.file = map_file(file_maps[sequence.unit], row.file);
+	}
+	return rows;
+}
@@ -0,0 +1,101 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <ostream>
+#include <string>
+#include <vector>
+
+#include "../common/line_decoder.h"
+#include "../common/line_table.h"
+
+#include "compact_line_table.h"
+#include "elf_file.h"
+#include "line_index.h"
+#include "line_loader.h"
+#include "sim.h"
+
+// Answers show-asm's queries against the line tables of an ELF file.
+class LineLookup
+{
+public:
+	virtual ~LineLookup() = default;
+
+	virtual std::vector<std::string> const &file_names() = 0;
+
+	// Find the row covering address, returning false if no row does.
+	virtual bool lookup_address(uint32_t address, LineTableRow &row) = 0;
+
+	// Find the merged address ranges generated for line of file, in address order.
+	virtual void lookup_line(uint16_t file, uint16_t line, std::vector<AddressRange> &ranges) = 0;
+
+	// Describe the memory used by the rows.
+	virtual void report_memory(std::ostream &out) = 0;
+};
+
+// Decodes every unit up front and indexes the result, using the on-disk cache if enabled.
+class EagerLineLookup : public LineLookup
+{
+	CompactLineTable rows;
+	std::vector<std::string> file_names_;
+	AddressIndex address_index;
+	SourceIndex source_index;
+
+public:
+	EagerLineLookup(ElfFile &elf_file, char const *elf_file_name, Decoder decoder, unsigned num_jobs, bool use_cache);
+
+	std::vector<std::string> const &file_names() override;
+	bool lookup_address(uint32_t address, LineTableRow &row) override;
+	void lookup_line(uint16_t file, uint16_t line, std::vector<AddressRange> &ranges) override;
+	void report_memory(std::ostream &out) override;
+};
+
+// Finds the sequences of every unit up front with the software decoder, but only decodes a
+// sequence the first time a query needs it. Decoded sequences are kept for later queries. With the
+// hardware decoder, the first address query on a sequence only reads back the rows around the
+// address, and the sequence is decoded in full if a different address in it is queried later.
+class LazyLineLookup : public LineLookup
+{
+	struct Sequence
+	{
+		uint32_t unit;
+		uint32_t offset;
+		uint32_t size;
+		uint32_t start_address;
+		uint32_t end_address;
+		uint32_t max_end_address; // of this and every sequence before it
+	};
+
+	struct FilteredRows
+	{
+		uint32_t address;
+		LineTable rows;
+	};
+
+	std::vector<LineProgram> const &line_programs;
+	Decoder decoder;
+	std::unique_ptr<Sim> sim;
+
+	std::vector<std::string> file_names_;
+	std::vector<std::vector<uint16_t>> file_maps;
+
+	std::vector<Sequence> sequences;        // sorted by start address
+	std::vector<uint32_t> file_sequences;   // sequence indices, grouped by file
+	std::vector<uint32_t> file_sequences_first; // per file, into file_sequences, plus an end marker
+	std::vector<std::unique_ptr<LineTable>> decoded; // per sequence, null until decoded
+	std::vector<std::unique_ptr<FilteredRows>> filtered; // per sequence, null unless filtered for one address
+
+public:
+	LazyLineLookup(ElfFile &elf_file, Decoder decoder);
+
+	std::vector<std::string> const &file_names() override;
+	bool lookup_address(uint32_t address, LineTableRow &row) override;
+	void lookup_line(uint16_t file, uint16_t line, std::vector<AddressRange> &ranges) override;
+	void report_memory(std::ostream &out) override;
+
+private:
+	Sim &hardware_sim();
+	LineTable const &sequence_rows(uint32_t sequence);
+	LineTable const &address_rows(uint32_t sequence, uint32_t address);
+	LineTable filtered_sequence_rows(uint32_t sequence, uint32_t address);
+};
@@ -1,90 +1,96 @@
+#include <algorithm>
+#include <charconv>
 #include <cstdint>
+#include <cstring>
 #include <iostream>
-#include <sstream>
+#include <memory>
 #include <string>
-#include <vector>
+#include <thread>
 
 #include "elf_file.h"
-#include "sim.h"
+#include "line_lookup.h"
+#include "query.h"
 
-void print_instruction_range(size_t start, Span const &code);
+[[noreturn]] static void print_usage() {
+	std::cerr << "usage: show-asm [--software] [--jobs <num-jobs>] [--no-cache] [--lazy]\n"
+	             "                [--batch <command-file>|-] <elf-file>\n";
+	exit(0);
+}
+
+// Parse a whole argument as an unsigned number, showing the usage if it isn't one.
+static unsigned parse_number(char const *argument) {
+	unsigned value;
+	char const *const end = argument + strlen(argument);
+	std::from_chars_result const result = std::from_chars(argument, end, value);
+	if (result.ec != std::errc() || result.ptr != end) {
+		print_usage();
+	}
+	return value;
+}
 
 int main(int argc, char **argv) {
-	if (argc != 2) {
-		std::cerr << "usage: show-asm <elf-file>\n";
-		return 0;
+	Decoder decoder   = DECODER_HARDWARE;
+	unsigned num_jobs = std::max(1u, std::thread::hardware_concurrency());
+	bool use_cache    = true;
+	bool lazy         = false;
+	char const *batch_file_name = nullptr;
+	char const *elf_file_name = nullptr;
+
+	for (int i = 1; i < argc; ++i) {
+		if (strcmp(argv[i], "--software") == 0) {
+			decoder = DECODER_SOFTWARE;
+		} else if (strcmp(argv[i], "--jobs") == 0 && i + 1 < argc) {
+			num_jobs = parse_number(argv[++i]);
+			if (num_jobs == 0) {
+				print_usage();
+			}
+		} else if (strcmp(argv[i], "--no-cache") == 0) {
+			use_cache = false;
+		} else if (strcmp(argv[i], "--lazy") == 0) {
+			lazy = true;
+		} else if (strcmp(argv[i], "--batch") == 0 && i + 1 < argc) {
+			batch_file_name = argv[++i];
+		} else if (argv[i][0] == '-' || elf_file_name) {
+			print_usage();
+		} else {
+			elf_file_name = argv[i];
+		}
+	}
+	if (!elf_file_name) {
+		print_usage();
 	}
 
-	ElfFile elf_file { argv[1] };
+	ElfFile elf_file { elf_file_name };
 
 	if (!elf_file.valid()) {
 		return -1;
 	}
 
-	uint32_t program_header = elf_file.program_header();
-	Span program_code       = elf_file.program_code();
+	std::unique_ptr<LineLookup> line_lookup;
+	if (lazy) {
+		line_lookup = std::make_unique<LazyLineLookup>(elf_file, decoder);
+	} else {
+		line_lookup = std::make_unique<EagerLineLookup>(elf_file, elf_file_name, decoder, num_jobs, use_cache);
+	}
 
-	Sim sim;
-	LineTable line_table = sim.run_program(program_header, program_code.data, program_code.size);
+	if (batch_file_name) {
+		// The lazy lookup memoizes as it goes, so it is only queried from one thread.
+		return run_batch(batch_file_name, *line_lookup, elf_file, lazy ? 1 : num_jobs) ? 0 : -1;
+	}
 
+	std::string out;
 	while (true) {
 		std::string input;
 		std::cout << "> ";
-		getline(std::cin, input);
-
-		std::vector<std::string> parts;
-		std::string part;
-		std::istringstream iss(input);
-		while (iss >> part) {
-			parts.push_back(part);
-		}
-
-		if (parts.empty()) {
-			continue;
+		if (!getline(std::cin, input)) {
+			break;
 		}
 
-		if (parts[0] == "q") {
+		out.clear();
+		bool const keep_going = run_query(input, *line_lookup, elf_file, out);
+		std::cout << out;
+		if (!keep_going) {
 			break;
-		} else if (parts[0] == "ls") {
-			if (parts.size() < 2) {
-				std::cout << "usage: ls [files]\n";
-			} else if (parts[1] == "files") {
-				std::vector<std::string> const &file_names = elf_file.file_names();
-				for (size_t i = 1; i < file_names.size(); ++i) {
-					std::cout << i << ". " << file_names[i] << '\n';
-				}
-			} else {
-				std::cout << "usage: ls [files]\n";
-			}
-		} else if (parts[0] == "p") {
-			if (parts.size() < 3) {
-				std::cout << "usage: p <file-index> <line-number>\n";
-			} else {
-				int file_index  = std::stoi(parts[1]);
-				int line_number = std::stoi(parts[2]);
-				std::vector<std::pair<size_t, size_t>> address_ranges;
-				size_t address_start;
-				bool in_range = false;
-				for (size_t i = 0; i < line_table.size(); ++i) {
-					if (in_range) {
-						if (line_table[i].file != file_index || line_table[i].line != line_number ||
-							line_table[i].end_sequence) {
-							in_range = false;
-							address_ranges.push_back({ address_start, line_table[i].address });
-						}
-					} else {
-						if (line_table[i].file == file_index && line_table[i].line == line_number &&
-							!line_table[i].end_sequence) {
-							in_range = true;
-							address_start = line_table[i].address;
-						}
-					}
-				}
-				for (auto const &range : address_ranges) {
-					auto const [start, end] = range;
-					print_instruction_range(start, elf_file.text(start, end));
-				}
-			}
 		}
 	}
 
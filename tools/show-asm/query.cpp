@@ -0,0 +1,210 @@
+#include <algorithm>
+#include <atomic>
+#include <cctype>
+#include <charconv>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <sstream>
+#include <thread>
+#include <vector>
+
+#include "query.h"
+
+// Output is written to stdout whenever the buffer grows past this.
+#define BATCH_BUFFER_SIZE (1 << 20)
+
+// The number of commands each worker takes at a time in a parallel batch.
+#define BATCH_CHUNK_COMMANDS 256
+
+void print_instruction_range(size_t start, Span const &code, std::string &out);
+
+static void split_words(std::string const &input, std::vector<std::string> &parts) {
+	parts.clear();
+	size_t i = 0;
+	while (i < input.size()) {
+		while (i < input.size() && isspace((unsigned char)input[i])) {
+			i += 1;
+		}
+		size_t const start = i;
+		while (i < input.size() && !isspace((unsigned char)input[i])) {
+			i += 1;
+		}
+		if (i > start) {
+			parts.emplace_back(input, start, i - start);
+		}
+	}
+}
+
+static bool parse_number(std::string const &part, int base, uint32_t max, uint32_t &value) {
+	char const *const end = part.data() + part.size();
+	std::from_chars_result const result = std::from_chars(part.data(), end, value, base);
+	return result.ec == std::errc() && result.ptr == end && value <= max;
+}
+
+static void append_hex8(std::string &out, uint32_t value) {
+	static char const digits[] = "0123456789abcdef";
+	for (int shift = 28; shift >= 0; shift -= 4) {
+		out += digits[(value >> shift) & 0xF];
+	}
+}
+
+bool run_query(std::string const &input, LineLookup &line_lookup, ElfFile &elf_file, std::string &out) {
+	thread_local std::vector<std::string> parts;
+	thread_local std::vector<AddressRange> ranges;
+
+	split_words(input, parts);
+
+	if (parts.empty()) {
+		return true;
+	}
+
+	std::vector<std::string> const &file_names = line_lookup.file_names();
+
+	if (parts[0] == "q") {
+		return false;
+	} else if (parts[0] == "ls") {
+		if (parts.size() < 2) {
+			out += "usage: ls [files]\n";
+		} else if (parts[1] == "files") {
+			for (size_t i = 1; i < file_names.size(); ++i) {
+				out += std::to_string(i);
+				out += ". ";
+				out += file_names[i];
+				out += '\n';
+			}
+		} else {
+			out += "usage: ls [files]\n";
+		}
+	} else if (parts[0] == "mem") {
+		std::ostringstream report;
+		line_lookup.report_memory(report);
+		out += report.str();
+	} else if (parts[0] == "a") {
+		if (parts.size() < 2) {
+			out += "usage: a <address>...\n";
+		}
+		for (size_t i = 1; i < parts.size(); ++i) {
+			uint32_t address;
+			if (!parse_number(parts[i], 16, UINT32_MAX, address)) {
+				out += "usage: a <address>...\n";
+				break;
+			}
+			LineTableRow line;
+			append_hex8(out, address);
+			out += ":  ";
+			if (line_lookup.lookup_address(address, line)) {
+				out += line.file < file_names.size() ? file_names[line.file] : "?";
+				out += ':';
+				out += std::to_string(line.line);
+				out += ':';
+				out += std::to_string(line.column);
+				out += '\n';
+			} else {
+				out += "no line information\n";
+			}
+		}
+	} else if (parts[0] == "p") {
+		uint32_t file_index;
+		uint32_t line_number;
+		if (parts.size() < 3 || !parse_number(parts[1], 10, UINT16_MAX, file_index) ||
+		    !parse_number(parts[2], 10, UINT16_MAX, line_number)) {
+			out += "usage: p <file-index> <line-number>\n";
+		} else {
+			line_lookup.lookup_line(file_index, line_number, ranges);
+			for (AddressRange const &range : ranges) {
+				print_instruction_range(range.start, elf_file.text(range.start, range.end), out);
+			}
+		}
+	}
+
+	return true;
+}
+
+static void write_output(std::string const &out) {
+	fwrite(out.data(), 1, out.size(), stdout);
+}
+
+bool run_batch(char const *batch_file_name, LineLookup &line_lookup, ElfFile &elf_file, unsigned num_jobs) {
+	std::string input;
+	if (strcmp(batch_file_name, "-") == 0) {
+		input.assign(std::istreambuf_iterator<char>(std::cin), std::istreambuf_iterator<char>());
+	} else {
+		std::ifstream batch_file(batch_file_name, std::ios::binary);
+		if (!batch_file) {
+			std::cerr << "failed to open batch file " << batch_file_name << '\n';
+			return false;
+		}
+		input.assign(std::istreambuf_iterator<char>(batch_file), std::istreambuf_iterator<char>());
+	}
+
+	// Commands after a quit are not run.
+	std::vector<std::string> commands;
+	std::vector<std::string> parts;
+	for (size_t start = 0; start < input.size();) {
+		size_t end = input.find('\n', start);
+		if (end == std::string::npos) {
+			end = input.size();
+		}
+		commands.emplace_back(input, start, end - start);
+		start = end + 1;
+		split_words(commands.back(), parts);
+		if (!parts.empty() && parts[0] == "q") {
+			commands.pop_back();
+			break;
+		}
+	}
+
+	auto const start = std::chrono::steady_clock::now();
+
+	if (num_jobs <= 1) {
+		std::string out;
+		out.reserve(BATCH_BUFFER_SIZE + BATCH_BUFFER_SIZE / 4);
+		for (std::string const &command : commands) {
+			run_query(command, line_lookup, elf_file, out);
+			if (out.size() >= BATCH_BUFFER_SIZE) {
+				write_output(out);
+				out.clear();
+			}
+		}
+		write_output(out);
+	} else {
+		// Each chunk of commands is run into its own buffer, and the buffers are written in order
+		// once every worker is done.
+		size_t const num_chunks = (commands.size() + BATCH_CHUNK_COMMANDS - 1) / BATCH_CHUNK_COMMANDS;
+		std::vector<std::string> outputs(num_chunks);
+		std::atomic<size_t> next_chunk { 0 };
+
+		auto worker = [&]() {
+			size_t chunk;
+			while ((chunk = next_chunk.fetch_add(1)) < num_chunks) {
+				size_t const first = chunk * BATCH_CHUNK_COMMANDS;
+				size_t const last  = std::min(first + BATCH_CHUNK_COMMANDS, commands.size());
+				for (size_t i = first; i < last; ++i) {
+					run_query(commands[i], line_lookup, elf_file, outputs[chunk]);
+				}
+			}
+		};
+
+		std::vector<std::thread> workers;
+		for (unsigned i = 0; i < num_jobs; ++i) {
+			workers.emplace_back(worker);
+		}
+		for (std::thread &thread : workers) {
+			thread.join();
+		}
+		for (std::string const &out : outputs) {
+			write_output(out);
+		}
+	}
+	fflush(stdout);
+
+	double const seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+	std::cerr << commands.size() << " queries in " << seconds << "s (" <<
+		(seconds > 0.0 ? commands.size() / seconds : 0.0) << " queries/s)\n";
+
+	return true;
+}
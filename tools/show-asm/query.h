@@ -0,0 +1,14 @@
+#pragma once
+
+#include <string>
+
+#include "elf_file.h"
+#include "line_lookup.h"
+
+// Run one show-asm command, appending its output to out. Returns false for the quit command.
+bool run_query(std::string const &input, LineLookup &line_lookup, ElfFile &elf_file, std::string &out);
+
+// Run every command in the file, or stdin for "-", writing the output to stdout in command order.
+// Commands are shared between num_jobs worker threads, so line_lookup must be safe to query
+// concurrently if num_jobs is more than 1. Returns false if the file cannot be read.
+bool run_batch(char const *batch_file_name, LineLookup &line_lookup, ElfFile &elf_file, unsigned num_jobs);
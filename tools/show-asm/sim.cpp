@@ -1,146 +1,98 @@
 #include "sim.h"
 
-#include "verilated_vcd_c.h"
+#include <cstring>
 
-#define STATUS_READY    0x0
-#define STATUS_EMIT_ROW 0x1
-#define STATUS_BUSY     0x2
-#define STATUS_ILLEGAL  0x3
-
-#define PROGRAM_HEADER    0x00
-#define PROGRAM_CODE      0x04
-#define AM_ADDRESS        0x08
-#define AM_FILE_DISCRIM   0x0C
-#define AM_LINE_COL_FLAGS 0x10
-#define STATUS            0x14
-#define INFO              0x18
-
-Sim::Sim() {
-	Verilated::traceEverOn(true);
+void Sim::set_status_wait(StatusWait status_wait_in) {
+	status_wait = status_wait_in;
+	set_int_mask(status_wait == STATUS_WAIT_INTERRUPT ? INT_MASK_ALL : 0);
+}
 
-	verilator_sim = std::make_unique<Vtqvp_laurie_dwarf_line_table_accelerator>();
-	verilator_sim->clk          = 0;
-	verilator_sim->rst_n        = 0;
-	verilator_sim->ui_in        = 0;
-	verilator_sim->address      = 0;
-	verilator_sim->data_in      = 0;
-	verilator_sim->data_write_n = 3;
-	verilator_sim->data_read_n  = 3;
-	run_cycle();
-	verilator_sim->rst_n = 1;
-	run_cycle();
+void Sim::set_int_mask(uint32_t int_mask_in) {
+	if (int_mask_in != int_mask) {
+		int_mask = int_mask_in;
+		bus.write_dword(INT_MASK, int_mask);
+	}
 }
 
-Sim::~Sim() {
-	verilator_sim->final();
+// Configure the hardware row filter for the following programs. A filter_ctrl of 0 reports every
+// row.
+void Sim::set_row_filter(uint32_t filter_lo, uint32_t filter_hi, uint32_t filter_ctrl) {
+	bus.write_dword(FILTER_LO, filter_lo);
+	bus.write_dword(FILTER_HI, filter_hi);
+	bus.write_dword(FILTER_CTRL, filter_ctrl);
 }
 
 LineTable Sim::run_program(uint32_t program_header, uint8_t *program_code, size_t program_code_size) {
 	LineTable line_table;
 
-	write_dword(PROGRAM_HEADER, program_header);
+	if (status_wait == STATUS_WAIT_INTERRUPT) {
+		set_int_mask(INT_MASK_ALL);
+	}
+	bus.write_dword(PROGRAM_HEADER, program_header);
 
 	size_t ip = 0;
-
-	while (ip < program_code_size) {
-		if (ip + 4 <= program_code_size) {
-			uint32_t code;
-			memcpy(&code, program_code + ip, sizeof(code));
-			write_dword(PROGRAM_CODE, code);
-			ip += sizeof(code);
-		} else if (ip + 2 <= program_code_size) {
-			uint16_t code;
-			memcpy(&code, program_code + ip, sizeof(code));
-			write_word(PROGRAM_CODE, code);
-			ip += sizeof(code);
-		} else {
-			write_byte(PROGRAM_CODE, program_code[ip]);
-			ip += 1;
+	LineTableRow prev_row = ROW_DELTA_INITIAL_ROW;
+
+	// Poll STATUS before every burst: a single chunk of code can emit several rows, and the row queue
+	// has to be drained for the accelerator to decode any further. Every row counted in STATUS is
+	// drained through ROW_DELTA before polling again. Each burst fills the free entries of the
+	// program code FIFO. When waiting on the interrupt, STATUS is only read once it is raised, or
+	// once INTERRUPT_TIMEOUT_CYCLES have passed without it, the same as polling.
+	while (true) {
+		if (status_wait == STATUS_WAIT_INTERRUPT) {
+			bus.wait_for_interrupt();
 		}
 
-		uint32_t status = read_dword(STATUS);
-		while (status == STATUS_BUSY) {
-			status = read_dword(STATUS);
-		}
+		uint32_t const status_fields = bus.read_dword(STATUS);
+		uint32_t const status        = status_fields & STATUS_CODE_MASK;
 		if (status == STATUS_EMIT_ROW) {
-			uint32_t const address        = read_dword(AM_ADDRESS);
-			uint32_t const file_discrim   = read_dword(AM_FILE_DISCRIM);
-			uint32_t const line_col_flags = read_dword(AM_LINE_COL_FLAGS);
-
-			LineTableRow row;
-			row.address        = address;
-			row.file           = file_discrim & 0xFFFF;
-			row.line           = line_col_flags & 0xFFFF;
-			row.column         = (line_col_flags >> 16) & 0x3FF;
-			row.is_stmt        = ((line_col_flags >> 26) & 1) == 1;
-			row.basic_block    = ((line_col_flags >> 27) & 1) == 1;
-			row.end_sequence   = ((line_col_flags >> 28) & 1) == 1;
-			row.prologue_end   = ((line_col_flags >> 29) & 1) == 1;
-			row.epilogue_begin = ((line_col_flags >> 30) & 1) == 1;
-			line_table.push_back(row);
-
-			write_dword(STATUS, 0);
+			uint32_t const queued_rows = (status_fields >> STATUS_ROW_QUEUE_SHIFT) & STATUS_ROW_QUEUE_MASK;
+			for (uint32_t i = 0; i < queued_rows; ++i) {
+				LineTableRow const row = bus.pop_row(ROW_DRAIN_DELTA, prev_row);
+				line_table.push_back(row);
+				prev_row = row.end_sequence ? ROW_DELTA_INITIAL_ROW : row;
+			}
 		} else if (status == STATUS_ILLEGAL) {
 			return { };
+		} else if (ip < program_code_size) {
+			uint32_t const free_entries = bus.read_dword(CODE_FIFO) & CODE_FIFO_FREE_MASK;
+			for (uint32_t i = 0; i < free_entries && ip < program_code_size; ++i) {
+				ip += write_code(program_code + ip, program_code_size - ip);
+			}
+			// With the whole program written, stop the code space source holding the interrupt
+			// raised, leaving ready to report the end of the program.
+			if ((int_mask & INT_MASK_CODE) != 0 && ip == program_code_size) {
+				set_int_mask(int_mask & ~INT_MASK_CODE);
+			}
+		} else if (status == STATUS_READY) {
+			break;
 		}
 	}
 
 	return line_table;
 }
 
-void Sim::run_cycle() {
-	verilator_sim->eval();
-	verilator_sim->clk = 1;
-	verilator_sim->eval();
-	verilator_sim->clk = 0;
-}
-
-void Sim::run_cycles(uint32_t cycles) {
-	for (uint32_t i = 0; i < cycles; ++i) {
-		run_cycle();
-	}
-}
-
-void Sim::write_dword(uint8_t reg, uint32_t dword) {
-	verilator_sim->address      = reg;
-	verilator_sim->data_in      = dword;
-	verilator_sim->data_write_n = 2;
-	run_cycle();
-	verilator_sim->data_write_n = 3;
-	run_cycles(8);
-}
-
-void Sim::write_word(uint8_t reg, uint16_t word) {
-	verilator_sim->address = reg;
-	verilator_sim->data_in = word;
-	verilator_sim->data_write_n = 1;
-	run_cycle();
-	verilator_sim->data_write_n = 3;
-	run_cycles(8);
-}
-
-void Sim::write_byte(uint8_t reg, uint8_t byte) {
-	verilator_sim->address = reg;
-	verilator_sim->data_in = byte;
-	verilator_sim->data_write_n = 0;
-	run_cycle();
-	verilator_sim->data_write_n = 3;
-	run_cycles(8);
-}
-
-uint32_t Sim::read_dword(uint8_t reg) {
-	verilator_sim->address     = reg;
-	verilator_sim->data_read_n = 2;
-	run_cycle();
-	verilator_sim->data_write_n = 3;
-	while (!verilator_sim->data_ready) {
-		run_cycle();
+// Write the next chunk of code, using the largest write that doesn't run off the end of the
+// program, and return the number of bytes written.
+size_t Sim::write_code(uint8_t const *code, size_t remaining) {
+	if (remaining >= 4) {
+		uint32_t dword;
+		memcpy(&dword, code, sizeof(dword));
+		bus.write_dword(PROGRAM_CODE, dword);
+		return sizeof(dword);
+	} else if (remaining >= 2) {
+		uint16_t word;
+		memcpy(&word, code, sizeof(word));
+		bus.write_word(PROGRAM_CODE, word);
+		return sizeof(word);
+	} else {
+		bus.write_byte(PROGRAM_CODE, code[0]);
+		return 1;
 	}
-	return verilator_sim->data_out;
 }
 
 double sc_time_stamp() {
-	static double time_counter = 0.0;
+	static thread_local double time_counter = 0.0;
 	time_counter += 1.0;
 	return time_counter;
 }
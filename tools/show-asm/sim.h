@@ -1,41 +1,29 @@
 #pragma once
 
 #include <cstdint>
-#include <memory>
-#include <vector>
 
-#include "Vtqvp_laurie_dwarf_line_table_accelerator.h"
-
-struct LineTableRow
-{
-	uint32_t address;
-	uint16_t file;
-	uint16_t line;
-	uint16_t column;
-	bool is_stmt;
-	bool basic_block;
-	bool end_sequence;
-	bool prologue_end;
-	bool epilogue_begin;
-};
-
-using LineTable = std::vector<LineTableRow>;
+#include "../common/bus.h"
+#include "../common/line_table.h"
 
 class Sim
 {
-	std::unique_ptr<Vtqvp_laurie_dwarf_line_table_accelerator> verilator_sim;
+	Bus bus;
 
-public:
-	Sim();
-	~Sim();
+	StatusWait status_wait = STATUS_WAIT_POLL;
+	uint32_t int_mask      = 0;
 
+public:
+	void set_write_pacing(WritePacing write_pacing, uint32_t bus_latency) {
+		bus.set_write_pacing(write_pacing, bus_latency);
+	}
+	uint64_t wasted_cycle_count() const { return bus.wasted_cycle_count(); }
+	uint32_t read_info() { return bus.read_dword(INFO); }
+
+	void set_status_wait(StatusWait status_wait_in);
+	void set_row_filter(uint32_t filter_lo, uint32_t filter_hi, uint32_t filter_ctrl);
 	LineTable run_program(uint32_t program_header, uint8_t *program_code, size_t program_code_size);
 
 private:
-	void run_cycle();
-	void run_cycles(uint32_t cycles);
-	void write_dword(uint8_t reg, uint32_t dword);
-	void write_word(uint8_t reg, uint16_t word);
-	void write_byte(uint8_t reg, uint8_t byte);
-	uint32_t read_dword(uint8_t reg);
+	void set_int_mask(uint32_t int_mask_in);
+	size_t write_code(uint8_t const *code, size_t remaining);
 };